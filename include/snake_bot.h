@@ -0,0 +1,64 @@
+#ifndef SNAKE_BOT_H
+#define SNAKE_BOT_H
+
+#include <stdint.h>
+
+// C ABI of the external bots (./snake --bot PATH).
+// A bot is a shared object exporting a 'snake_bot_t' descriptor named
+// SNAKE_BOT_SYMBOL. The game asks it for a direction every time the
+// snake is about to move, handing it a read-only view of the board.
+// Bots are called from the simulation thread, one call at a time.
+//
+// Every decision is timed against 'budget_ns'. A late decision is
+// dropped (the snake keeps its direction) and counts as a strike;
+// the game can be configured to disqualify a bot after some strikes.
+//
+// Compatibility: fields are only ever appended to the structs below
+// and SNAKE_BOT_ABI_VERSION is bumped when that happens.
+
+#define SNAKE_BOT_ABI_VERSION 1
+#define SNAKE_BOT_SYMBOL "snake_bot"
+
+typedef enum snake_bot_direction_t
+{
+	SNAKE_BOT_KEEP	= 0, // keep moving in the current direction
+	SNAKE_BOT_LEFT	= 1,
+	SNAKE_BOT_RIGHT = 2,
+	SNAKE_BOT_UP	= 3,
+	SNAKE_BOT_DOWN	= 4
+} snake_bot_direction_t;
+
+typedef struct snake_bot_point_t
+{
+	int16_t x;
+	int16_t y;
+} snake_bot_point_t;
+
+typedef struct snake_bot_view_t
+{
+	uint32_t				 abi_version;
+	uint32_t				 tick;		   // snake moves so far
+	uint16_t				 board_size;   // square board, the outer ring is a wall
+	uint16_t				 board_stride; // row length of 'cells'
+	const uint8_t			*cells;		   // cells[y * board_stride + x] != 0: wall or body
+	const snake_bot_point_t *body;		   // head first
+	uint32_t				 body_length;
+	const snake_bot_point_t *fruits;
+	uint32_t				 fruits_length;
+	uint8_t					 direction; // current snake_bot_direction_t
+} snake_bot_view_t;
+
+typedef struct snake_bot_t
+{
+	uint32_t	abi_version; // SNAKE_BOT_ABI_VERSION the bot was built with
+	const char *name;
+
+	// optional, called once before the first decision
+	void (*init)(uint16_t board_size, uint32_t seed);
+	// returns a snake_bot_direction_t
+	uint8_t (*decide)(const snake_bot_view_t *view, uint64_t budget_ns);
+	// optional, called on exit or when the bot is disqualified
+	void (*dispose)(void);
+} snake_bot_t;
+
+#endif
@@ -0,0 +1,444 @@
+#define _POSIX_C_SOURCE 200809L
+#include "arena.h"
+#include "board.h"
+#include "common.h"
+#include "mem.h"
+#include <unistd.h>
+
+#define ARENA_SPAWN_TRIES 16 // random cells tried per spawn, a crowded arena spawns later
+#define ARENA_BODY(arena, id) ((arena)->bodies + (size_t)(id)*ARENA_MAX_LENGTH)
+
+// board index delta per snake_direction_t
+static const int32_t steps[] = { 0, -1, 1, -BOARD_STRIDE, BOARD_STRIDE };
+
+static void				*work(void *arg);
+static void				 move_phase(arena_t *arena, uint32_t first, uint32_t last);
+static void				 advance_phase(arena_t *arena, uint32_t first, uint32_t last);
+static void				 serial_phase(arena_t *arena);
+static snake_direction_t decide(const arena_t *arena, arena_snake_t *snake, uint32_t id);
+static uint32_t			 space(const arena_t *arena, uint32_t cell);
+static void				 claim(arena_t *arena, uint32_t cell, uint32_t id);
+static void				 spawn_snake(arena_t *arena, uint32_t id);
+static void				 spawn_fruit(arena_t *arena, uint32_t slot);
+static uint32_t			 free_cell(arena_t *arena);
+
+// 'threads' 0 runs a thread per CPU, the calling thread being one of them
+void arena_init(arena_t *arena, uint32_t snakes, uint32_t threads, uint32_t seed)
+{
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	memset(arena, 0, sizeof(arena_t));
+	arena->snake_count	= snakes;
+	arena->fruit_count	= snakes; // a fruit per snake
+	arena->worker_count = threads ? threads : cpus > 0 ? cpus : 1;
+	arena->worker_count = arena->worker_count < snakes ? arena->worker_count : snakes;
+	arena->rng			= random_seed(seed, 0);
+	arena->cells		= mem_calloc(BOARD_CELLS, sizeof(uint32_t));
+	arena->claims		= mem_calloc(BOARD_CELLS, sizeof(uint64_t));
+	arena->fruit_at		= mem_calloc(BOARD_CELLS, sizeof(uint32_t));
+	arena->fruits		= mem_calloc(arena->fruit_count, sizeof(uint32_t));
+	arena->bodies		= mem_calloc((size_t)snakes * ARENA_MAX_LENGTH, sizeof(uint32_t));
+	arena->snakes		= mem_calloc(snakes, sizeof(arena_snake_t));
+	arena->workers		= mem_calloc(arena->worker_count, sizeof(arena_worker_t));
+
+	ASSERT(arena->cells && arena->claims && arena->fruit_at && arena->fruits && arena->bodies && arena->snakes && arena->workers);
+
+	for (uint32_t i = 0; i < BOARD_SIZE; i++)
+	{
+		arena->cells[BOARD_INDEX(i, 0)]				 = ARENA_WALL;
+		arena->cells[BOARD_INDEX(i, BOARD_SIZE - 1)] = ARENA_WALL;
+		arena->cells[BOARD_INDEX(0, i)]				 = ARENA_WALL;
+		arena->cells[BOARD_INDEX(BOARD_SIZE - 1, i)] = ARENA_WALL;
+	}
+
+	for (uint32_t id = 0; id < snakes; id++)
+	{
+		arena->snakes[id].rng = random_seed(seed, id + 1);
+		spawn_snake(arena, id);
+	}
+
+	for (uint32_t slot = 0; slot < arena->fruit_count; slot++)
+	{
+		spawn_fruit(arena, slot);
+	}
+
+	// contiguous ranges of snakes, they share no cache lines but at the edges
+	arena->running = true;
+	pthread_barrier_init(&arena->barrier, NULL, arena->worker_count);
+
+	for (uint32_t i = 0; i < arena->worker_count; i++)
+	{
+		arena->workers[i].arena = arena;
+		arena->workers[i].first = (uint64_t)snakes * i / arena->worker_count;
+		arena->workers[i].last	= (uint64_t)snakes * (i + 1) / arena->worker_count;
+
+		if (i)
+		{
+			ASSERT(!pthread_create(&arena->workers[i].handle, NULL, &work, &arena->workers[i]));
+		}
+	}
+}
+
+void arena_dispose(arena_t *arena)
+{
+	// the workers wait for the next tick, they find the arena stopped
+	arena->running = false;
+	pthread_barrier_wait(&arena->barrier);
+
+	for (uint32_t i = 1; i < arena->worker_count; i++)
+	{
+		pthread_join(arena->workers[i].handle, NULL);
+	}
+
+	pthread_barrier_destroy(&arena->barrier);
+	mem_free(arena->cells);
+	mem_free(arena->claims);
+	mem_free(arena->fruit_at);
+	mem_free(arena->fruits);
+	mem_free(arena->bodies);
+	mem_free(arena->snakes);
+	mem_free(arena->workers);
+	memset(arena, 0, sizeof(arena_t));
+}
+
+// the calling thread is the first worker, the serial phase is its own
+void arena_tick(arena_t *arena)
+{
+	arena_worker_t *worker = &arena->workers[0];
+
+	arena->tick++;
+	pthread_barrier_wait(&arena->barrier);
+	move_phase(arena, worker->first, worker->last);
+	pthread_barrier_wait(&arena->barrier);
+	advance_phase(arena, worker->first, worker->last);
+	pthread_barrier_wait(&arena->barrier);
+	serial_phase(arena);
+}
+
+// FNV-1a of the board, the fruits and the snakes: runs ending on the same
+// state have the same checksum
+uint64_t arena_checksum(const arena_t *arena)
+{
+	uint64_t hash = 14695981039346656037ULL;
+
+	for (uint32_t i = 0; i < BOARD_CELLS; i++)
+	{
+		hash = (hash ^ arena->cells[i]) * 1099511628211ULL;
+	}
+
+	for (uint32_t slot = 0; slot < arena->fruit_count; slot++)
+	{
+		hash = (hash ^ arena->fruits[slot]) * 1099511628211ULL;
+	}
+
+	for (uint32_t id = 0; id < arena->snake_count; id++)
+	{
+		hash = (hash ^ arena->snakes[id].score) * 1099511628211ULL;
+		hash = (hash ^ arena->snakes[id].length) * 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+// snake moves per second, and the checksum to compare runs on different
+// thread counts
+void arena_bench(uint32_t snakes, uint32_t threads, uint32_t ticks, uint32_t seed)
+{
+	arena_t			arena;
+	struct timespec start, end;
+
+	arena_init(&arena, snakes, threads, seed ? seed : (uint32_t)time(NULL));
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (uint32_t i = 0; i < ticks; i++)
+	{
+		arena_tick(&arena);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	float64_t seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	fprintf(stderr, "arena: %u snakes x %u ticks on %u threads in %.3fs, %.0f snake-moves/s\n", arena.snake_count, ticks,
+			arena.worker_count, seconds, arena.moves / seconds);
+	fprintf(stderr, "  %llu fruits eaten, %llu deaths (%llu head-on), checksum %016llx\n", (unsigned long long)arena.fruits_eaten,
+			(unsigned long long)arena.deaths, (unsigned long long)arena.head_on, (unsigned long long)arena_checksum(&arena));
+
+	arena_dispose(&arena);
+}
+
+// worker threads, in lockstep with arena_tick
+static void *work(void *arg)
+{
+	arena_worker_t *worker = arg;
+	arena_t		   *arena	= worker->arena;
+
+	for (;;)
+	{
+		pthread_barrier_wait(&arena->barrier);
+
+		if (!arena->running)
+		{
+			return NULL;
+		}
+
+		move_phase(arena, worker->first, worker->last);
+		pthread_barrier_wait(&arena->barrier);
+		advance_phase(arena, worker->first, worker->last);
+		pthread_barrier_wait(&arena->barrier);
+	}
+}
+
+// directions and claims, the board is read only
+static void move_phase(arena_t *arena, uint32_t first, uint32_t last)
+{
+	for (uint32_t id = first; id < last; id++)
+	{
+		arena_snake_t *snake = &arena->snakes[id];
+
+		if (!snake->length)
+		{
+			continue;
+		}
+
+		snake->direction = decide(arena, snake, id);
+		snake->next		 = ARENA_BODY(arena, id)[snake->head] + steps[snake->direction];
+		snake->dying	 = arena->cells[snake->next] != ARENA_EMPTY;
+		snake->ate		 = false;
+
+		if (!snake->dying)
+		{
+			claim(arena, snake->next, id);
+		}
+	}
+}
+
+// The claim winners move. A snake only writes its head cell (free at the
+// start of the tick, nobody else's tail) and its tail cell, the fruits
+// are left to the serial phase.
+static void advance_phase(arena_t *arena, uint32_t first, uint32_t last)
+{
+	for (uint32_t id = first; id < last; id++)
+	{
+		arena_snake_t *snake = &arena->snakes[id];
+		uint32_t	  *body  = ARENA_BODY(arena, id);
+
+		if (!snake->length || snake->dying)
+		{
+			continue;
+		}
+
+		if ((uint32_t)arena->claims[snake->next] != id)
+		{
+			snake->dying = true;
+			continue;
+		}
+
+		snake->ate = arena->fruit_at[snake->next] != 0;
+
+		// the tail leaves its cell unless the snake grows
+		if (!snake->ate || snake->length == ARENA_MAX_LENGTH)
+		{
+			arena->cells[body[(snake->head + ARENA_MAX_LENGTH - snake->length + 1) % ARENA_MAX_LENGTH]] = ARENA_EMPTY;
+			snake->length--;
+		}
+
+		snake->head				  = (snake->head + 1) % ARENA_MAX_LENGTH;
+		body[snake->head]		  = snake->next;
+		arena->cells[snake->next] = id + 1;
+		snake->length++;
+	}
+}
+
+// By snake id: scores, eaten fruits and deaths. Respawns draw from the
+// arena's random numbers, here only.
+static void serial_phase(arena_t *arena)
+{
+	for (uint32_t id = 0; id < arena->snake_count; id++)
+	{
+		arena_snake_t *snake = &arena->snakes[id];
+		uint32_t	  *body  = ARENA_BODY(arena, id);
+
+		if (!snake->length)
+		{
+			spawn_snake(arena, id); // still waiting for a free cell
+			continue;
+		}
+
+		if (snake->dying)
+		{
+			// a claim of this tick on the cell ahead: it was free, another snake took it
+			arena->deaths++;
+			arena->head_on += arena->claims[snake->next] >> 32 == arena->tick;
+
+			for (uint32_t i = 0; i < snake->length; i++)
+			{
+				arena->cells[body[(snake->head + ARENA_MAX_LENGTH - i) % ARENA_MAX_LENGTH]] = ARENA_EMPTY;
+			}
+
+			snake->length = 0;
+			spawn_snake(arena, id);
+			continue;
+		}
+
+		arena->moves++;
+		snake->score += points_movement;
+
+		if (snake->ate)
+		{
+			uint32_t slot = arena->fruit_at[snake->next] - 1;
+
+			arena->fruits_eaten++;
+			arena->fruit_at[snake->next] = 0;
+			snake->score += points_fruit_eaten;
+			spawn_fruit(arena, slot);
+		}
+	}
+
+	// fruits still waiting for a free cell
+	for (uint32_t slot = 0; slot < arena->fruit_count; slot++)
+	{
+		if (arena->fruits[slot] == ARENA_WALL)
+		{
+			spawn_fruit(arena, slot);
+		}
+	}
+}
+
+// Toward the snake's fruit (the one on its slot), among the moves that
+// lead to ARENA_LOOKAHEAD free cells, if any. Ties go to a random move,
+// drawn from the snake's own random numbers. Keeps going when blocked.
+static snake_direction_t decide(const arena_t *arena, arena_snake_t *snake, uint32_t id)
+{
+	uint32_t		  head	= ARENA_BODY(arena, id)[snake->head];
+	uint32_t		  fruit = arena->fruits[id % arena->fruit_count];
+	snake_direction_t best	= snake->direction;
+	uint64_t		  least = UINT64_MAX;
+
+	for (uint8_t d = SNAKE_DIRECTION_LEFT; d <= SNAKE_DIRECTION_BOTTOM; d++)
+	{
+		uint32_t cell = head + steps[d];
+
+		if (arena->cells[cell] != ARENA_EMPTY)
+		{
+			continue;
+		}
+
+		uint32_t distance = 0;
+
+		if (fruit != ARENA_WALL)
+		{
+			distance = abs((int32_t)BOARD_INDEX_X(cell) - (int32_t)BOARD_INDEX_X(fruit)) +
+					   abs((int32_t)BOARD_INDEX_Y(cell) - (int32_t)BOARD_INDEX_Y(fruit));
+		}
+
+		// room first, then distance, then chance
+		uint64_t key = (uint64_t)(ARENA_LOOKAHEAD - space(arena, cell)) << 48 | (uint64_t)distance << 16 | (random_next(&snake->rng) & 0xffff);
+
+		if (key < least)
+		{
+			least = key;
+			best  = d;
+		}
+	}
+
+	return best;
+}
+
+// free cells reached from 'cell' (free) breadth first, ARENA_LOOKAHEAD at most
+static uint32_t space(const arena_t *arena, uint32_t cell)
+{
+	uint32_t queue[ARENA_LOOKAHEAD];
+	uint32_t length = 0;
+
+	queue[length++] = cell;
+
+	for (uint32_t i = 0; i < length && length < ARENA_LOOKAHEAD; i++)
+	{
+		for (uint8_t d = SNAKE_DIRECTION_LEFT; d <= SNAKE_DIRECTION_BOTTOM && length < ARENA_LOOKAHEAD; d++)
+		{
+			uint32_t next = queue[i] + steps[d];
+			bool	 seen = arena->cells[next] != ARENA_EMPTY;
+
+			for (uint32_t j = 0; j < length && !seen; j++)
+			{
+				seen = queue[j] == next;
+			}
+
+			if (!seen)
+			{
+				queue[length++] = next;
+			}
+		}
+	}
+
+	return length;
+}
+
+// Keeps the lowest id claiming the cell on this tick, whatever the order
+// the claims come in. Claims of older ticks are smaller, they're just
+// overwritten: the grid is never cleared.
+static void claim(arena_t *arena, uint32_t cell, uint32_t id)
+{
+	uint64_t value	 = (uint64_t)arena->tick << 32 | id;
+	uint64_t current = __atomic_load_n(&arena->claims[cell], __ATOMIC_RELAXED);
+
+	while (current >> 32 != arena->tick || value < current)
+	{
+		if (__atomic_compare_exchange_n(&arena->claims[cell], &current, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		{
+			break;
+		}
+	}
+}
+
+// a one cell snake on a free cell, or none until there's one
+static void spawn_snake(arena_t *arena, uint32_t id)
+{
+	arena_snake_t *snake = &arena->snakes[id];
+	uint32_t	   cell	  = free_cell(arena);
+
+	if (cell == ARENA_WALL)
+	{
+		return;
+	}
+
+	snake->head				 = 0;
+	snake->length			 = 1;
+	snake->score			 = 0;
+	snake->direction		 = SNAKE_DIRECTION_LEFT + random_next(&arena->rng) % 4;
+	snake->dying			 = false;
+	snake->ate				 = false;
+	ARENA_BODY(arena, id)[0] = cell;
+	arena->cells[cell]		 = id + 1;
+}
+
+static void spawn_fruit(arena_t *arena, uint32_t slot)
+{
+	uint32_t cell = free_cell(arena);
+
+	arena->fruits[slot] = cell;
+
+	if (cell != ARENA_WALL)
+	{
+		arena->fruit_at[cell] = slot + 1;
+	}
+}
+
+// a random free cell without a fruit, ARENA_WALL after ARENA_SPAWN_TRIES misses
+static uint32_t free_cell(arena_t *arena)
+{
+	for (uint8_t i = 0; i < ARENA_SPAWN_TRIES; i++)
+	{
+		uint32_t x	  = 1 + random_next(&arena->rng) % (BOARD_SIZE - 2);
+		uint32_t y	  = 1 + random_next(&arena->rng) % (BOARD_SIZE - 2);
+		uint32_t cell = BOARD_INDEX(x, y);
+
+		if (arena->cells[cell] == ARENA_EMPTY && !arena->fruit_at[cell])
+		{
+			return cell;
+		}
+	}
+
+	return ARENA_WALL;
+}
@@ -0,0 +1,83 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "defs.h"
+#include "rules.h"
+#include <pthread.h>
+
+// Arena: hundreds of AI snakes sharing one board, a load test of the
+// engine (./snake --arena SNAKES --train TICKS, best on BOARD=huge).
+// Every snake moves once per tick: there are no speeds and no fruit
+// timers, eaten fruits respawn right away. A tick has three phases:
+// - move, in parallel: the snakes are split among the threads, each one
+//   picks a direction and claims the cell ahead on the claim grid with an
+//   atomic compare-and-swap that keeps the lowest snake id;
+// - advance, in parallel: the claim winners move their head and tail on
+//   the occupancy grid, the other snakes die;
+// - eat and die, serial by snake id: eaten fruits respawn, dead snakes
+//   leave the board and respawn, on cells drawn from the arena's random
+//   numbers.
+// A phase only reads what the previous phases wrote and a claim goes to
+// the lowest id whatever the order of the threads: a run ends on the
+// same board for any number of threads (same checksum).
+// The cell ahead must be free when the tick starts: unlike the game, a
+// snake can't follow a tail into the cell it leaves on the same tick.
+
+#define ARENA_DEFAULT_TICKS 10000 // --arena without --train
+#define ARENA_MAX_LENGTH 256	  // body cells per snake, longer snakes stop growing
+#define ARENA_LOOKAHEAD 24		  // free cells a move must lead to, when there's a choice
+#define ARENA_EMPTY 0			  // occupancy: free, ARENA_WALL or snake id + 1
+#define ARENA_WALL UINT32_MAX
+
+typedef struct arena_snake_t
+{
+	uint32_t		  next;	  // cell ahead, claimed on the move phase
+	uint32_t		  head;	  // ring position of the head on the body
+	uint32_t		  length; // 0: dead, waiting for a free cell to respawn
+	uint32_t		  score;
+	uint32_t		  rng; // xorshift32, the snake's own moves
+	snake_direction_t direction;
+	bool			  dying; // blocked or lost its claim this tick
+	bool			  ate;
+} arena_snake_t;
+
+typedef struct arena_t arena_t;
+
+typedef struct arena_worker_t
+{
+	arena_t	 *arena;
+	pthread_t handle;
+	uint32_t  first; // snakes [first, last)
+	uint32_t  last;
+} arena_worker_t;
+
+struct arena_t
+{
+	uint32_t		 *cells;	// occupancy, BOARD_CELLS
+	uint64_t		 *claims;	// tick << 32 | id of the lowest claimer, BOARD_CELLS
+	uint32_t		 *fruit_at; // fruit slot + 1 per cell, 0: none
+	uint32_t		 *fruits;	// cell per fruit slot, ARENA_WALL while waiting for a cell
+	uint32_t		 *bodies;	// ARENA_MAX_LENGTH ring of cells per snake
+	arena_snake_t	 *snakes;
+	arena_worker_t	 *workers; // the calling thread is the first one
+	pthread_barrier_t barrier;
+	uint32_t		  snake_count;
+	uint32_t		  fruit_count;
+	uint32_t		  worker_count;
+	uint32_t		  rng; // xorshift32, serial phase
+	uint32_t		  tick;
+	bool			  running;
+	// totals
+	uint64_t moves;
+	uint64_t fruits_eaten;
+	uint64_t deaths;
+	uint64_t head_on; // deaths on a lost claim
+};
+
+void	 arena_init(arena_t *arena, uint32_t snakes, uint32_t threads, uint32_t seed);
+void	 arena_dispose(arena_t *arena);
+void	 arena_tick(arena_t *arena);
+uint64_t arena_checksum(const arena_t *arena);
+void	 arena_bench(uint32_t snakes, uint32_t threads, uint32_t ticks, uint32_t seed);
+
+#endif
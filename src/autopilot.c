@@ -0,0 +1,389 @@
+#define _POSIX_C_SOURCE 200809L
+#include "autopilot.h"
+#include "board.h"
+#include "common.h"
+#include "mem.h"
+#include "rules.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Soak-mode autopilot (./snake --autopilot). It follows a Hamiltonian
+// cycle over the playable board, so the snake can never hit itself,
+// and takes shortcuts towards the closest fruit while it's short.
+//
+// The cycle is stored as one 2-bit direction per board cell (board
+// stride layout, so a lookup is a shift and a mask) and cached on disk
+// per board size. Later runs map the cache read-only. On load the cycle
+// is walked once to number its cells, and every decision is then O(1).
+//
+// The cycle goes around a random spanning tree of the board split in
+// 2x2 blocks, so it winds through the whole board instead of sweeping
+// rows and shortcuts have more choices.
+
+#define AUTOPILOT_BLOCKS ((BOARD_SIZE - 2) / 2) // 2x2 blocks per row
+#define AUTOPILOT_CELLS ((BOARD_SIZE - 2) * (BOARD_SIZE - 2))
+#define AUTOPILOT_TABLE_SIZE ((BOARD_CELLS + 3) / 4)
+// moves kept between the head and the tail when taking a shortcut:
+// eaten fruits grow the snake later, holding the tail still meanwhile
+#define AUTOPILOT_MARGIN 8
+
+#define CYCLE_CODE(table, index) (((table)[(index) >> 2] >> (((index)&3) << 1)) & 3)
+
+typedef char autopilot_size_check_t[BOARD_SIZE % 2 == 0 ? 1 : -1];
+
+typedef struct cycle_header_t
+{
+	uint32_t magic;
+	uint16_t board_size;
+	uint16_t board_stride;
+} cycle_header_t;
+
+#define AUTOPILOT_CACHE_SIZE (sizeof(cycle_header_t) + AUTOPILOT_TABLE_SIZE)
+
+// indexed by cycle code, code + 1 is the snake_bot_direction_t
+static const int16_t cell_offset[] = { -1, 1, -BOARD_STRIDE, BOARD_STRIDE };
+
+static uint8_t		 *cache = NULL; // header and table
+static const uint8_t *cycle = NULL;
+#ifdef __linux__
+static bool mapped = false; // cache is the file mapping
+#endif
+static uint16_t		  order[BOARD_CELLS]; // position of every cell along the cycle
+
+static void		build_cycle(uint8_t *table);
+static bool		index_cycle(void);
+static uint16_t distance(uint16_t from, uint16_t to);
+static bool		load_cache(const char *path);
+static void		save_cache(const char *path);
+
+void autopilot_open(void)
+{
+	char path[32];
+	snprintf(path, sizeof(path), AUTOPILOT_CACHE_FILE, BOARD_SIZE);
+
+	if (load_cache(path))
+	{
+		return;
+	}
+
+	cache = mem_calloc(AUTOPILOT_CACHE_SIZE, 1);
+	ASSERT(cache);
+
+	cycle_header_t *header = (cycle_header_t *)cache;
+	header->magic		   = AUTOPILOT_CACHE_MAGIC;
+	header->board_size	   = BOARD_SIZE;
+	header->board_stride   = BOARD_STRIDE;
+
+	build_cycle(cache + sizeof(cycle_header_t));
+	cycle = cache + sizeof(cycle_header_t);
+	ASSERT(index_cycle());
+	save_cache(path);
+}
+
+void autopilot_close(void)
+{
+	if (!cache)
+	{
+		return;
+	}
+
+#ifdef __linux__
+	if (mapped)
+	{
+		munmap(cache, AUTOPILOT_CACHE_SIZE);
+	}
+	else
+#endif
+	{
+		mem_free(cache);
+	}
+
+	cache = NULL;
+	cycle = NULL;
+}
+
+bool autopilot_is_active(void)
+{
+	return cycle != NULL;
+}
+
+uint8_t autopilot_decide(const snake_bot_view_t *view)
+{
+	uint32_t head	  = BOARD_INDEX(view->body[0].x, view->body[0].y);
+	uint32_t tail	  = BOARD_INDEX(view->body[view->body_length - 1].x, view->body[view->body_length - 1].y);
+	uint8_t	 best	  = CYCLE_CODE(cycle, head) + 1;
+	uint16_t fruit_d  = UINT16_MAX;
+	uint16_t fruit_at = 0;
+
+	// past half the board shortcuts are too risky, just follow the cycle
+	if (view->body_length >= AUTOPILOT_CELLS / 2)
+	{
+		return best;
+	}
+
+	for (uint32_t i = 0; i < view->fruits_length; i++)
+	{
+		uint16_t at = order[BOARD_INDEX(view->fruits[i].x, view->fruits[i].y)];
+		uint16_t d	= distance(order[head], at);
+
+		if (d && d < fruit_d)
+		{
+			fruit_d	 = d;
+			fruit_at = at;
+		}
+	}
+
+	if (fruit_d == UINT16_MAX)
+	{
+		return best;
+	}
+
+	// the body always lies on the cycle between the tail and the head,
+	// so any free cell ahead of the head and behind the tail is safe
+	uint16_t room	= view->body_length > 1 ? distance(order[head], order[tail]) : AUTOPILOT_CELLS;
+	uint16_t best_d = fruit_d - 1;
+
+	for (uint8_t code = 0; code < 4; code++)
+	{
+		uint32_t cell = head + cell_offset[code];
+
+		if (view->cells[cell])
+		{
+			continue; // wall or body
+		}
+
+		uint16_t skip = distance(order[head], order[cell]);
+		uint16_t d	  = distance(order[cell], fruit_at);
+
+		if (skip + AUTOPILOT_MARGIN < room && skip <= fruit_d && d < best_d)
+		{
+			best   = code + 1;
+			best_d = d;
+		}
+	}
+
+	return best;
+}
+
+// Random spanning tree over the 2x2 blocks (randomized DFS), then every
+// cell points to the next one going around the tree counterclockwise.
+// Going around a spanning tree visits each cell once: a Hamiltonian
+// cycle of the playable board.
+static void build_cycle(uint8_t *table)
+{
+	static bool		edge_right[AUTOPILOT_BLOCKS * AUTOPILOT_BLOCKS];
+	static bool		edge_down[AUTOPILOT_BLOCKS * AUTOPILOT_BLOCKS];
+	static bool		visited[AUTOPILOT_BLOCKS * AUTOPILOT_BLOCKS];
+	static uint16_t stack[AUTOPILOT_BLOCKS * AUTOPILOT_BLOCKS];
+	uint16_t		stack_length = 0;
+	uint32_t		state		 = 0x9e3779b9; // fixed, the cycle only depends on the board
+
+	memset(edge_right, 0, sizeof(edge_right));
+	memset(edge_down, 0, sizeof(edge_down));
+	memset(visited, 0, sizeof(visited));
+
+	visited[0]			  = true;
+	stack[stack_length++] = 0;
+
+	while (stack_length)
+	{
+		uint16_t block = stack[stack_length - 1];
+		uint16_t bx = block % AUTOPILOT_BLOCKS, by = block / AUTOPILOT_BLOCKS;
+		uint16_t next[4];
+		uint8_t	 next_length = 0;
+
+		if (bx > 0 && !visited[block - 1])
+		{
+			next[next_length++] = block - 1;
+		}
+		if (bx < AUTOPILOT_BLOCKS - 1 && !visited[block + 1])
+		{
+			next[next_length++] = block + 1;
+		}
+		if (by > 0 && !visited[block - AUTOPILOT_BLOCKS])
+		{
+			next[next_length++] = block - AUTOPILOT_BLOCKS;
+		}
+		if (by < AUTOPILOT_BLOCKS - 1 && !visited[block + AUTOPILOT_BLOCKS])
+		{
+			next[next_length++] = block + AUTOPILOT_BLOCKS;
+		}
+
+		if (!next_length)
+		{
+			stack_length--;
+			continue;
+		}
+
+		uint16_t to = next[random_next(&state) % next_length];
+
+		if (to == block + 1)
+		{
+			edge_right[block] = true;
+		}
+		else if (to == block - 1)
+		{
+			edge_right[to] = true;
+		}
+		else if (to > block)
+		{
+			edge_down[block] = true;
+		}
+		else
+		{
+			edge_down[to] = true;
+		}
+
+		visited[to]			  = true;
+		stack[stack_length++] = to;
+	}
+
+	for (uint16_t ly = 0; ly < BOARD_SIZE - 2; ly++)
+	{
+		for (uint16_t lx = 0; lx < BOARD_SIZE - 2; lx++)
+		{
+			uint16_t bx = lx / 2, by = ly / 2;
+			uint16_t block = by * AUTOPILOT_BLOCKS + bx;
+			bool	 left  = bx > 0 && edge_right[block - 1];
+			bool	 up	   = by > 0 && edge_down[block - AUTOPILOT_BLOCKS];
+			uint8_t	 code;
+
+			// codes: 0 left, 1 right, 2 up, 3 down
+			if (!(lx & 1) && !(ly & 1))
+			{
+				code = left ? 0 : 3; // top left
+			}
+			else if (!(lx & 1))
+			{
+				code = edge_down[block] ? 3 : 1; // bottom left
+			}
+			else if (ly & 1)
+			{
+				code = edge_right[block] ? 1 : 2; // bottom right
+			}
+			else
+			{
+				code = up ? 2 : 0; // top right
+			}
+
+			uint32_t index = BOARD_INDEX(lx + 1, ly + 1);
+			table[index >> 2] |= code << ((index & 3) << 1);
+		}
+	}
+}
+
+// Numbers the cells along the cycle, false if 'cycle' isn't a
+// Hamiltonian cycle of the playable board (a corrupted cache).
+static bool index_cycle(void)
+{
+	uint32_t start = BOARD_INDEX(1, 1);
+	uint32_t cell  = start;
+
+	memset(order, 0xff, sizeof(order));
+
+	for (uint16_t i = 0; i < AUTOPILOT_CELLS; i++)
+	{
+		uint16_t x = BOARD_INDEX_X(cell), y = BOARD_INDEX_Y(cell);
+
+		if (x < 1 || x > BOARD_SIZE - 2 || y < 1 || y > BOARD_SIZE - 2 || order[cell] != UINT16_MAX)
+		{
+			return false;
+		}
+
+		order[cell] = i;
+		cell += cell_offset[CYCLE_CODE(cycle, cell)];
+	}
+
+	return cell == start;
+}
+
+// moves from 'from' to 'to' following the cycle
+static uint16_t distance(uint16_t from, uint16_t to)
+{
+	return to >= from ? to - from : to + AUTOPILOT_CELLS - from;
+}
+
+#ifdef __linux__
+
+static bool load_cache(const char *path)
+{
+	struct stat info;
+	int			fd = open(path, O_RDONLY);
+
+	if (fd == -1)
+	{
+		return false;
+	}
+
+	if (fstat(fd, &info) == -1 || info.st_size != (off_t)AUTOPILOT_CACHE_SIZE)
+	{
+		close(fd);
+		return false;
+	}
+
+	uint8_t *map = mmap(NULL, AUTOPILOT_CACHE_SIZE, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (map == MAP_FAILED)
+	{
+		return false;
+	}
+
+	const cycle_header_t *header = (const cycle_header_t *)map;
+	cycle						 = map + sizeof(cycle_header_t);
+
+	if (header->magic != AUTOPILOT_CACHE_MAGIC || header->board_size != BOARD_SIZE ||
+		header->board_stride != BOARD_STRIDE || !index_cycle())
+	{
+		munmap(map, AUTOPILOT_CACHE_SIZE);
+		cycle = NULL;
+		return false;
+	}
+
+	cache  = map;
+	mapped = true;
+
+	return true;
+}
+
+// best effort: written aside and renamed, so a concurrent game never
+// maps a half-written cache
+static void save_cache(const char *path)
+{
+	char tmp_path[48];
+	snprintf(tmp_path, sizeof(tmp_path), "%s.%d", path, (int)getpid());
+
+	FILE *f = fopen(tmp_path, "wb");
+
+	if (!f)
+	{
+		return;
+	}
+
+	bool written = fwrite(cache, AUTOPILOT_CACHE_SIZE, 1, f) == 1;
+
+	if (fclose(f) || !written || rename(tmp_path, path))
+	{
+		remove(tmp_path);
+	}
+}
+
+#else
+
+static bool load_cache(const char *path)
+{
+	(void)path;
+	return false;
+}
+
+static void save_cache(const char *path)
+{
+	(void)path;
+}
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef AUTOPILOT_H
+#define AUTOPILOT_H
+
+#include "defs.h"
+#include <snake_bot.h>
+
+#define AUTOPILOT_CACHE_FILE "cycle_%d.bin" // per board size, next to score.txt
+#define AUTOPILOT_CACHE_MAGIC 0x314d4148	// "HAM1"
+
+void	autopilot_open(void);
+void	autopilot_close(void);
+bool	autopilot_is_active(void);
+uint8_t autopilot_decide(const snake_bot_view_t *view);
+
+#endif
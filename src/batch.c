@@ -0,0 +1,385 @@
+#define _POSIX_C_SOURCE 199309L
+#include "batch.h"
+#include "board.h"
+#include "common.h"
+#include "mem.h"
+
+#define BATCH_RING_CELLS (BOARD_SIZE * BOARD_SIZE)
+#define BATCH_SPAWN_TRIES 8 // random cells tried per spawn, a crowded board spawns later
+
+// scalar access to the lanes, 'array' is per game or per fruit slot and game
+#define BATCH_GAME(array, type, game) (((type *)(array))[game])
+#define BATCH_FRUIT(batch, array, type, slot, game) (((type *)(batch)->array)[(slot) * (batch)->games + (game)])
+
+// vector code: board index delta per direction (comparisons are -1 when
+// true) and mask of the cells on the walls
+#define BATCH_STEP(direction) (((direction) == SNAKE_DIRECTION_LEFT) - ((direction) == SNAKE_DIRECTION_RIGHT) + \
+							   (((direction) == SNAKE_DIRECTION_TOP) - ((direction) == SNAKE_DIRECTION_BOTTOM)) * BOARD_STRIDE)
+#define BATCH_WALL(cell) ((BOARD_INDEX_X(cell) == 0) | (BOARD_INDEX_X(cell) == BOARD_SIZE - 1) | \
+						  (BOARD_INDEX_Y(cell) == 0) | (BOARD_INDEX_Y(cell) == BOARD_SIZE - 1))
+
+static void	  tick_fruits(batch_t *batch, float32_t delta_time);
+static void	  tick_snakes(batch_t *batch, float32_t delta_time);
+static void	  move_game(batch_t *batch, uint32_t game);
+static void	  spawn_fruit(batch_t *batch, uint32_t game);
+static void	  end_game(batch_t *batch, uint32_t game);
+static void	  reset_game(batch_t *batch, uint32_t game);
+static int8_t fruit_slot(const batch_t *batch, uint32_t game, int32_t cell, int32_t status);
+static bool	  any(const batch_i32_t *mask);
+
+batch_t batch_new(uint32_t games, uint32_t seed)
+{
+	batch_t batch = { .games = (games + BATCH_LANES - 1) / BATCH_LANES * BATCH_LANES };
+
+	batch.vectors		= batch.games / BATCH_LANES;
+	batch.head			= mem_calloc(batch.vectors, sizeof(batch_i32_t));
+	batch.next			= mem_calloc(batch.vectors, sizeof(batch_i32_t));
+	batch.direction		= mem_calloc(batch.vectors, sizeof(batch_i32_t));
+	batch.moving		= mem_calloc(batch.vectors, sizeof(batch_i32_t));
+	batch.walled		= mem_calloc(batch.vectors, sizeof(batch_i32_t));
+	batch.elapsed		= mem_calloc(batch.vectors, sizeof(batch_f32_t));
+	batch.speed			= mem_calloc(batch.vectors, sizeof(batch_f32_t));
+	batch.score			= mem_calloc(batch.vectors, sizeof(batch_u32_t));
+	batch.rng			= mem_calloc(batch.vectors, sizeof(batch_u32_t));
+	batch.spawn_elapsed = mem_calloc(batch.vectors, sizeof(batch_f32_t));
+	batch.spawn_delay	= mem_calloc(batch.vectors, sizeof(batch_f32_t));
+	batch.fruit_status	= mem_calloc(batch.vectors * FRUIT_POOL_LENGTH, sizeof(batch_i32_t));
+	batch.fruit_cell	= mem_calloc(batch.vectors * FRUIT_POOL_LENGTH, sizeof(batch_i32_t));
+	batch.fruit_elapsed = mem_calloc(batch.vectors * FRUIT_POOL_LENGTH, sizeof(batch_f32_t));
+	batch.boards		= mem_calloc(batch.games, BOARD_CELLS);
+	batch.rings			= mem_calloc(batch.games, sizeof(uint16_t) * BATCH_RING_CELLS);
+	batch.ring_tails	= mem_calloc(batch.games, sizeof(uint32_t));
+	batch.lengths		= mem_calloc(batch.games, sizeof(uint32_t));
+
+	ASSERT(batch.head && batch.next && batch.direction && batch.moving && batch.walled && batch.elapsed && batch.speed && batch.score &&
+		   batch.rng && batch.spawn_elapsed && batch.spawn_delay && batch.fruit_status && batch.fruit_cell && batch.fruit_elapsed &&
+		   batch.boards && batch.rings && batch.ring_tails && batch.lengths);
+
+	for (uint32_t game = 0; game < batch.games; game++)
+	{
+		uint8_t *board = batch.boards + (size_t)game * BOARD_CELLS;
+
+		for (uint8_t i = 0; i < BOARD_SIZE; i++)
+		{
+			board[BOARD_INDEX(i, 0)]			  = true;
+			board[BOARD_INDEX(i, BOARD_SIZE - 1)] = true;
+			board[BOARD_INDEX(0, i)]			  = true;
+			board[BOARD_INDEX(BOARD_SIZE - 1, i)] = true;
+		}
+
+		BATCH_GAME(batch.rng, uint32_t, game) = random_seed(seed, game);
+		reset_game(&batch, game);
+	}
+
+	return batch;
+}
+
+void batch_dispose(batch_t *batch)
+{
+	mem_free(batch->head);
+	mem_free(batch->next);
+	mem_free(batch->direction);
+	mem_free(batch->moving);
+	mem_free(batch->walled);
+	mem_free(batch->elapsed);
+	mem_free(batch->speed);
+	mem_free(batch->score);
+	mem_free(batch->rng);
+	mem_free(batch->spawn_elapsed);
+	mem_free(batch->spawn_delay);
+	mem_free(batch->fruit_status);
+	mem_free(batch->fruit_cell);
+	mem_free(batch->fruit_elapsed);
+	mem_free(batch->boards);
+	mem_free(batch->rings);
+	mem_free(batch->ring_tails);
+	mem_free(batch->lengths);
+	memset(batch, 0, sizeof(batch_t));
+}
+
+// one simulation step of every game, in the order of screen_game.c:
+// fruits first, then the snakes
+void batch_tick(batch_t *batch, float32_t delta_time)
+{
+	batch->ticks++;
+	tick_fruits(batch, delta_time);
+	tick_snakes(batch, delta_time);
+}
+
+// game-ticks per second of a single thread, the batch engine's figure
+// of merit
+void batch_bench(uint32_t games, uint32_t ticks, uint32_t seed)
+{
+	batch_t			batch = batch_new(games, seed ? seed : (uint32_t)time(NULL));
+	struct timespec start, end;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (uint32_t i = 0; i < ticks; i++)
+	{
+		batch_tick(&batch, 1.0 / sim_tick_rate);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	float64_t seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	fprintf(stderr, "batch: %u games x %u ticks in %.3fs, %.0f game-ticks/s on one core\n", batch.games, ticks, seconds,
+			(float64_t)batch.games * ticks / seconds);
+	fprintf(stderr, "  %llu moves, %llu fruits eaten, %llu games over (mean score %.1f)\n", (unsigned long long)batch.moves,
+			(unsigned long long)batch.fruits_eaten, (unsigned long long)batch.games_over,
+			batch.games_over ? (float64_t)batch.games_over_score / batch.games_over : 0);
+
+	batch_dispose(&batch);
+}
+
+// Fruit timers of every slot, expiring fruits and the spawn timer are
+// vector code. Games with a fruit to expire or to spawn go scalar.
+static void tick_fruits(batch_t *batch, float32_t delta_time)
+{
+	batch_f32_t dt = (batch_f32_t) {} + delta_time;
+
+	for (uint32_t v = 0; v < batch->vectors; v++)
+	{
+		batch_i32_t events = {};
+
+		for (uint8_t slot = 0; slot < FRUIT_POOL_LENGTH; slot++)
+		{
+			uint32_t	i	   = slot * batch->vectors + v;
+			batch_i32_t active = batch->fruit_status[i] == FRUIT_STATUS_ACTIVE;
+
+			batch->fruit_elapsed[i] += (batch_f32_t)((batch_i32_t)dt & active);
+			events |= active & (batch->fruit_elapsed[i] > fruit_lifetime);
+		}
+
+		batch->spawn_elapsed[v] += dt;
+		events |= batch->spawn_elapsed[v] > batch->spawn_delay[v];
+
+		if (!any(&events))
+		{
+			continue;
+		}
+
+		for (uint32_t game = v * BATCH_LANES; game < (v + 1) * BATCH_LANES; game++)
+		{
+			for (uint8_t slot = 0; slot < FRUIT_POOL_LENGTH; slot++)
+			{
+				if (BATCH_FRUIT(batch, fruit_status, int32_t, slot, game) == FRUIT_STATUS_ACTIVE &&
+					BATCH_FRUIT(batch, fruit_elapsed, float32_t, slot, game) > fruit_lifetime)
+				{
+					BATCH_FRUIT(batch, fruit_status, int32_t, slot, game) = FRUIT_STATUS_IDLE;
+				}
+			}
+
+			if (BATCH_GAME(batch->spawn_elapsed, float32_t, game) > BATCH_GAME(batch->spawn_delay, float32_t, game))
+			{
+				spawn_fruit(batch, game);
+			}
+		}
+	}
+}
+
+// Move timers, steering, the next head, wall collisions and the score of
+// a move are vector code. Games moving this tick go scalar for their body.
+static void tick_snakes(batch_t *batch, float32_t delta_time)
+{
+	for (uint32_t v = 0; v < batch->vectors; v++)
+	{
+		batch_f32_t elapsed = batch->elapsed[v] + delta_time;
+		batch_i32_t due		= elapsed >= batch->speed[v];
+
+		batch->elapsed[v] = (batch_f32_t)((batch_i32_t)elapsed & ~due);
+
+		// a quarter of the moves turn left or right at random, and so
+		// does a snake facing a wall; random_next on every lane
+		batch_u32_t r = batch->rng[v];
+		r ^= r << 13;
+		r ^= r >> 17;
+		r ^= r << 5;
+		batch->rng[v] = r;
+
+		batch_i32_t direction  = batch->direction[v];
+		batch_i32_t next	   = batch->head[v] + (BATCH_STEP(direction) & due);
+		batch_i32_t turn	   = due & (((batch_i32_t)(r & 3) == 0) | BATCH_WALL(next));
+		batch_i32_t horizontal = direction <= SNAKE_DIRECTION_RIGHT;
+		batch_i32_t turned	   = SNAKE_DIRECTION_LEFT + (horizontal & 2) + (batch_i32_t)(r >> 2 & 1);
+
+		direction			= (turned & turn) | (direction & ~turn);
+		next				= batch->head[v] + (BATCH_STEP(direction) & due);
+		batch->direction[v] = direction;
+
+		batch->next[v]	 = next;
+		batch->moving[v] = due;
+		batch->walled[v] = due & BATCH_WALL(next);
+		batch->score[v] += (batch_u32_t)due & points_movement;
+
+		if (!any(&due))
+		{
+			continue;
+		}
+
+		for (uint32_t game = v * BATCH_LANES; game < (v + 1) * BATCH_LANES; game++)
+		{
+			if (BATCH_GAME(batch->moving, int32_t, game))
+			{
+				move_game(batch, game);
+			}
+		}
+	}
+}
+
+// move_snake, check_eaten_fruits and check_collision of screen_game.c
+// on the body ring of one game
+static void move_game(batch_t *batch, uint32_t game)
+{
+	uint8_t	 *board	 = batch->boards + (size_t)game * BOARD_CELLS;
+	uint16_t *ring	 = batch->rings + (size_t)game * BATCH_RING_CELLS;
+	uint32_t *tail	 = &batch->ring_tails[game];
+	uint32_t *length = &batch->lengths[game];
+	int32_t	  next	 = BATCH_GAME(batch->next, int32_t, game);
+	int8_t	  slot;
+
+	batch->moves++;
+
+	if (BATCH_GAME(batch->walled, int32_t, game))
+	{
+		end_game(batch, game);
+		return;
+	}
+
+	// an eaten fruit grows the snake once the tail leaves its cell
+	if ((slot = fruit_slot(batch, game, ring[*tail], FRUIT_STATUS_EATEN)) >= 0)
+	{
+		BATCH_FRUIT(batch, fruit_status, int32_t, slot, game) = FRUIT_STATUS_IDLE;
+	}
+	else
+	{
+		board[ring[*tail]] = false;
+		*tail			   = (*tail + 1) % BATCH_RING_CELLS;
+		(*length)--;
+	}
+
+	if (board[next])
+	{
+		end_game(batch, game);
+		return;
+	}
+
+	board[next]									= true;
+	ring[(*tail + *length) % BATCH_RING_CELLS] = next;
+	(*length)++;
+	BATCH_GAME(batch->head, int32_t, game) = next;
+
+	if ((slot = fruit_slot(batch, game, next, FRUIT_STATUS_ACTIVE)) >= 0)
+	{
+		float32_t *speed = &BATCH_GAME(batch->speed, float32_t, game);
+
+		BATCH_FRUIT(batch, fruit_status, int32_t, slot, game) = FRUIT_STATUS_EATEN;
+		BATCH_GAME(batch->score, uint32_t, game) += points_fruit_eaten;
+		batch->fruits_eaten++;
+
+		if (*speed > snake_speed_max)
+		{
+			*speed -= snake_speed_acceleration;
+		}
+	}
+}
+
+// first idle slot on a free cell of the spawn area, if a few tries find one
+static void spawn_fruit(batch_t *batch, uint32_t game)
+{
+	uint8_t	 *board = batch->boards + (size_t)game * BOARD_CELLS;
+	uint32_t *rng	= &BATCH_GAME(batch->rng, uint32_t, game);
+	int8_t	  slot	= fruit_slot(batch, game, -1, FRUIT_STATUS_IDLE);
+
+	if (slot < 0)
+	{
+		return;
+	}
+
+	for (uint8_t i = 0; i < BATCH_SPAWN_TRIES; i++)
+	{
+		uint32_t r	  = random_next(rng);
+		uint8_t	 x	  = BOARD_PADDING + r % (BOARD_SIZE - 2 * BOARD_PADDING);
+		uint8_t	 y	  = BOARD_PADDING + (r >> 16) % (BOARD_SIZE - 2 * BOARD_PADDING);
+		int32_t	 cell = BOARD_INDEX(x, y);
+
+		if (board[cell] || fruit_slot(batch, game, cell, FRUIT_STATUS_ACTIVE) >= 0 || fruit_slot(batch, game, cell, FRUIT_STATUS_EATEN) >= 0)
+		{
+			continue;
+		}
+
+		BATCH_FRUIT(batch, fruit_status, int32_t, slot, game)	  = FRUIT_STATUS_ACTIVE;
+		BATCH_FRUIT(batch, fruit_cell, int32_t, slot, game)		  = cell;
+		BATCH_FRUIT(batch, fruit_elapsed, float32_t, slot, game) = 0;
+		BATCH_GAME(batch->spawn_elapsed, float32_t, game)		  = 0;
+		BATCH_GAME(batch->spawn_delay, float32_t, game)			  = fruit_spawn_delay_min + random_next(rng) % fruit_spawn_delay_range;
+		return;
+	}
+}
+
+static void end_game(batch_t *batch, uint32_t game)
+{
+	batch->games_over++;
+	batch->games_over_score += BATCH_GAME(batch->score, uint32_t, game);
+	reset_game(batch, game);
+}
+
+// a new game on the same lanes, the board only loses its body
+static void reset_game(batch_t *batch, uint32_t game)
+{
+	uint8_t	 *board	 = batch->boards + (size_t)game * BOARD_CELLS;
+	uint16_t *ring	 = batch->rings + (size_t)game * BATCH_RING_CELLS;
+	uint32_t  center = BOARD_INDEX(BOARD_SIZE / 2, BOARD_SIZE / 2);
+
+	for (uint32_t i = 0; i < batch->lengths[game]; i++)
+	{
+		board[ring[(batch->ring_tails[game] + i) % BATCH_RING_CELLS]] = false;
+	}
+
+	for (uint8_t slot = 0; slot < FRUIT_POOL_LENGTH; slot++)
+	{
+		BATCH_FRUIT(batch, fruit_status, int32_t, slot, game) = FRUIT_STATUS_IDLE;
+	}
+
+	board[center]			 = true;
+	ring[0]					 = center;
+	batch->ring_tails[game] = 0;
+	batch->lengths[game]	 = 1;
+
+	BATCH_GAME(batch->head, int32_t, game)				= center;
+	BATCH_GAME(batch->direction, int32_t, game)		= SNAKE_DIRECTION_LEFT;
+	BATCH_GAME(batch->elapsed, float32_t, game)		= 0;
+	BATCH_GAME(batch->speed, float32_t, game)			= snake_speed_init;
+	BATCH_GAME(batch->score, uint32_t, game)			= 0;
+	BATCH_GAME(batch->spawn_elapsed, float32_t, game) = 0;
+	BATCH_GAME(batch->spawn_delay, float32_t, game)	= 0;
+}
+
+// slot of a fruit with this status on 'cell' (any cell: -1), -1 if none
+static int8_t fruit_slot(const batch_t *batch, uint32_t game, int32_t cell, int32_t status)
+{
+	for (uint8_t slot = 0; slot < FRUIT_POOL_LENGTH; slot++)
+	{
+		if (BATCH_FRUIT(batch, fruit_status, int32_t, slot, game) == status &&
+			(cell < 0 || BATCH_FRUIT(batch, fruit_cell, int32_t, slot, game) == cell))
+		{
+			return slot;
+		}
+	}
+
+	return -1;
+}
+
+// by address: vectors wider than the target's don't go by value
+static bool any(const batch_i32_t *mask)
+{
+	int32_t lanes = 0;
+
+	for (uint8_t i = 0; i < BATCH_LANES; i++)
+	{
+		lanes |= (*mask)[i];
+	}
+
+	return lanes != 0;
+}
@@ -0,0 +1,67 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "defs.h"
+#include "rules.h"
+
+// Batch engine: many independent headless games stepped in lockstep,
+// for large scale evaluation (./snake --batch GAMES --train TICKS).
+// The per game scalars (head, direction, move timer, speed, score...)
+// are stored as struct-of-arrays, BATCH_LANES games per vector: the
+// parts of the tick every game runs (timers, steering, the next head,
+// wall collisions and scoring) cost a few vector instructions for
+// BATCH_LANES games at once. Body moves, eating, spawning and game
+// overs only happen to a few games on a given tick, they run as scalar
+// code on those games only.
+// The rules are the game's (rules.h, screen_game.c) with two changes:
+// snakes steer with random turns instead of keys, and fruits spawn on a
+// random free cell, reachable or not.
+
+#define BATCH_LANES 8			   // games per vector
+#define BATCH_DEFAULT_TICKS 100000 // --batch without --train
+
+// gcc vector extensions, lowered to the vector unit of the target (SSE2,
+// AVX2, NEON...). Allocations are only element aligned.
+typedef int32_t	  batch_i32_t __attribute__((vector_size(BATCH_LANES * sizeof(int32_t)), aligned(sizeof(int32_t))));
+typedef uint32_t  batch_u32_t __attribute__((vector_size(BATCH_LANES * sizeof(uint32_t)), aligned(sizeof(uint32_t))));
+typedef float32_t batch_f32_t __attribute__((vector_size(BATCH_LANES * sizeof(float32_t)), aligned(sizeof(float32_t))));
+
+typedef struct batch_t
+{
+	uint32_t games;	  // a multiple of BATCH_LANES
+	uint32_t vectors; // games / BATCH_LANES
+	// per game, 'vectors' long
+	batch_i32_t *head;			// board index
+	batch_i32_t *next;			// head after this tick's move
+	batch_i32_t *direction;		// snake_direction_t
+	batch_i32_t *moving;		// mask: the snake moves this tick
+	batch_i32_t *walled;		// mask: ... into a wall
+	batch_f32_t *elapsed;		// since the last move
+	batch_f32_t *speed;			// seconds per move
+	batch_u32_t *score;
+	batch_u32_t *rng;			// xorshift32
+	batch_f32_t *spawn_elapsed; // since the last fruit spawn
+	batch_f32_t *spawn_delay;	// until the next one
+	// per fruit slot and game, FRUIT_POOL_LENGTH * 'vectors' long
+	batch_i32_t *fruit_status; // fruit_status_t
+	batch_i32_t *fruit_cell;
+	batch_f32_t *fruit_elapsed;
+	// per game, scalar code only
+	uint8_t	 *boards; // BOARD_CELLS per game, walls and body are nonzero
+	uint16_t *rings;  // body cells from the tail, BOARD_SIZE * BOARD_SIZE per game
+	uint32_t *ring_tails;
+	uint32_t *lengths;
+	// totals
+	uint64_t ticks;
+	uint64_t moves;
+	uint64_t fruits_eaten;
+	uint64_t games_over;
+	uint64_t games_over_score; // sum of the final scores
+} batch_t;
+
+batch_t batch_new(uint32_t games, uint32_t seed);
+void	batch_dispose(batch_t *batch);
+void	batch_tick(batch_t *batch, float32_t delta_time);
+void	batch_bench(uint32_t games, uint32_t ticks, uint32_t seed);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+// Board geometry is fixed at build time (make BOARD=<preset>), so every
+// index and bounds computation folds into constants.
+// Rows are BOARD_STRIDE cells long, a power of two not smaller than
+// BOARD_SIZE, which turns (x, y) <-> index conversions into shifts
+// and masks. Cells past BOARD_SIZE on every row are never reached:
+// the outer ring of the board is a wall.
+#if defined(BOARD_PRESET_SMALL)
+#define BOARD_SIZE 12
+#define BOARD_STRIDE_SHIFT 4
+#elif defined(BOARD_PRESET_LARGE)
+#define BOARD_SIZE 40
+#define BOARD_STRIDE_SHIFT 6
+#elif defined(BOARD_PRESET_HUGE) // larger than the terminal, played through a camera
+#define BOARD_SIZE 200
+#define BOARD_STRIDE_SHIFT 8
+#else // BOARD_PRESET_CLASSIC
+#define BOARD_SIZE 20
+#define BOARD_STRIDE_SHIFT 5
+#endif
+
+#define BOARD_PADDING 2 // fruits are never placed this close to the walls
+#define BOARD_STRIDE (1 << BOARD_STRIDE_SHIFT)
+#define BOARD_CELLS (BOARD_STRIDE * BOARD_SIZE)
+#define BOARD_ROW_WORDS ((BOARD_SIZE + 63) / 64) // 64-bit words of a packed board row (flood fill)
+
+#define BOARD_INDEX(x, y) (((y) << BOARD_STRIDE_SHIFT) | (x))
+#define BOARD_INDEX_X(index) ((index) & (BOARD_STRIDE - 1))
+#define BOARD_INDEX_Y(index) ((index) >> BOARD_STRIDE_SHIFT)
+
+// BOARD_PADDING <= x, y < BOARD_SIZE - BOARD_PADDING, one compare per axis
+#define BOARD_IN_SPAWN_AREA(x, y) ((uint32_t)((x)-BOARD_PADDING) < (BOARD_SIZE - 2 * BOARD_PADDING) && \
+								   (uint32_t)((y)-BOARD_PADDING) < (BOARD_SIZE - 2 * BOARD_PADDING))
+
+typedef char board_stride_check_t[BOARD_STRIDE >= BOARD_SIZE ? 1 : -1];
+
+#endif
@@ -0,0 +1,191 @@
+#define _POSIX_C_SOURCE 200809L
+#include "bot.h"
+#include "board.h"
+#include "common.h"
+
+#ifdef __linux__
+#include <dlfcn.h>
+#endif
+
+// Loads an external bot (see include/snake_bot.h) and referees it:
+// every decision is timed, late decisions are dropped and counted as
+// strikes, and a bot reaching 'max_strikes' is disqualified. A call
+// can't be interrupted, so the budget is enforced on the result: the
+// snake only follows decisions that arrived in time.
+// Latencies go to a log2 histogram reported on unload.
+
+typedef struct bot_t
+{
+	void			  *handle;
+	const snake_bot_t *entry;
+	uint64_t		   budget_ns;
+	uint32_t		   max_strikes; // 0: never disqualified
+	uint32_t		   strikes;
+	uint64_t		   decisions;
+	uint64_t		   latency_max;
+	uint64_t		   histogram[BOT_HISTOGRAM_BUCKETS];
+	bool			   disqualified;
+} bot_t;
+
+static bot_t bot;
+
+#ifdef __linux__
+
+static void		report(void);
+static uint64_t get_time_ns(void);
+
+bool bot_load(const char *path, uint64_t budget_ns, uint32_t max_strikes, uint32_t seed)
+{
+	memset(&bot, 0, sizeof(bot_t));
+	bot.handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+
+	if (!bot.handle)
+	{
+		fprintf(stderr, "%s\n", dlerror());
+		return false;
+	}
+
+	bot.entry = dlsym(bot.handle, SNAKE_BOT_SYMBOL);
+
+	if (!bot.entry || !bot.entry->decide || bot.entry->abi_version != SNAKE_BOT_ABI_VERSION)
+	{
+		fprintf(stderr, "%s: no '%s' descriptor for bot ABI version %d\n", path, SNAKE_BOT_SYMBOL, SNAKE_BOT_ABI_VERSION);
+		dlclose(bot.handle);
+		bot.handle = NULL;
+		return false;
+	}
+
+	bot.budget_ns	= budget_ns;
+	bot.max_strikes = max_strikes;
+
+	if (bot.entry->init)
+	{
+		bot.entry->init(BOARD_SIZE, seed);
+	}
+
+	return true;
+}
+
+void bot_unload(void)
+{
+	if (!bot.handle)
+	{
+		return;
+	}
+
+	if (!bot.disqualified && bot.entry->dispose)
+	{
+		bot.entry->dispose();
+	}
+
+	report();
+	dlclose(bot.handle);
+	bot.handle = NULL;
+}
+
+bool bot_is_active(void)
+{
+	return bot.handle && !bot.disqualified;
+}
+
+uint8_t bot_decide(const snake_bot_view_t *view)
+{
+	uint64_t start	   = get_time_ns();
+	uint8_t	 direction = bot.entry->decide(view, bot.budget_ns);
+	uint64_t latency   = get_time_ns() - start;
+	uint8_t	 bucket	   = latency ? 63 - __builtin_clzll(latency) : 0;
+
+	bot.decisions++;
+	bot.histogram[bucket < BOT_HISTOGRAM_BUCKETS ? bucket : BOT_HISTOGRAM_BUCKETS - 1]++;
+
+	if (latency > bot.latency_max)
+	{
+		bot.latency_max = latency;
+	}
+
+	if (latency <= bot.budget_ns)
+	{
+		return direction <= SNAKE_BOT_DOWN ? direction : SNAKE_BOT_KEEP;
+	}
+
+	bot.strikes++;
+
+	if (bot.max_strikes && bot.strikes >= bot.max_strikes)
+	{
+		bot.disqualified = true;
+
+		if (bot.entry->dispose)
+		{
+			bot.entry->dispose();
+		}
+	}
+
+	return SNAKE_BOT_KEEP;
+}
+
+static void report(void)
+{
+	uint64_t peak = 1;
+
+	for (uint8_t i = 0; i < BOT_HISTOGRAM_BUCKETS; i++)
+	{
+		if (bot.histogram[i] > peak)
+		{
+			peak = bot.histogram[i];
+		}
+	}
+
+	fprintf(stderr, "bot '%s': %llu decisions, %u late (budget %lluns), max %lluns%s\n",
+			bot.entry->name ? bot.entry->name : "unnamed",
+			(unsigned long long)bot.decisions, bot.strikes,
+			(unsigned long long)bot.budget_ns, (unsigned long long)bot.latency_max,
+			bot.disqualified ? ", disqualified" : "");
+
+	for (uint8_t i = 0; i < BOT_HISTOGRAM_BUCKETS; i++)
+	{
+		if (!bot.histogram[i])
+		{
+			continue;
+		}
+
+		char bar[41] = { '\0' };
+		memset(bar, '#', bot.histogram[i] * 40 / peak);
+		fprintf(stderr, "  < %11lluns %10llu %s\n", 2ULL << i, (unsigned long long)bot.histogram[i], bar);
+	}
+}
+
+static uint64_t get_time_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+#else
+
+bool bot_load(const char *path, uint64_t budget_ns, uint32_t max_strikes, uint32_t seed)
+{
+	(void)path;
+	(void)budget_ns;
+	(void)max_strikes;
+	(void)seed;
+	return false;
+}
+
+void bot_unload(void)
+{
+}
+
+bool bot_is_active(void)
+{
+	return false;
+}
+
+uint8_t bot_decide(const snake_bot_view_t *view)
+{
+	(void)view;
+	return SNAKE_BOT_KEEP;
+}
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef BOT_H
+#define BOT_H
+
+#include "defs.h"
+#include <snake_bot.h>
+
+#define BOT_HISTOGRAM_BUCKETS 32 // power of two nanosecond buckets, up to ~2s
+
+bool	bot_load(const char *path, uint64_t budget_ns, uint32_t max_strikes, uint32_t seed);
+void	bot_unload(void);
+bool	bot_is_active(void);
+uint8_t bot_decide(const snake_bot_view_t *view);
+
+#endif
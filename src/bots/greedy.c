@@ -0,0 +1,50 @@
+#include <snake_bot.h>
+#include <stdlib.h>
+
+// Example bot: heads for the closest fruit, never steps on a blocked
+// cell when it can avoid it. Build it with 'make bots' and play it
+// with ./snake --bot bots/greedy.so
+
+static const int8_t dx[] = { 0, -1, 1, 0, 0 };
+static const int8_t dy[] = { 0, 0, 0, -1, 1 };
+
+static uint8_t decide(const snake_bot_view_t *view, uint64_t budget_ns)
+{
+	(void)budget_ns;
+	snake_bot_point_t head	 = view->body[0];
+	uint8_t			  best	 = SNAKE_BOT_KEEP;
+	int32_t			  best_d = INT32_MAX;
+
+	for (uint8_t direction = SNAKE_BOT_LEFT; direction <= SNAKE_BOT_DOWN; direction++)
+	{
+		int16_t x = head.x + dx[direction];
+		int16_t y = head.y + dy[direction];
+
+		if (view->cells[y * view->board_stride + x])
+		{
+			continue;
+		}
+
+		int32_t d = view->board_size * 2; // no fruit: any free cell will do
+
+		for (uint32_t i = 0; i < view->fruits_length; i++)
+		{
+			int32_t fd = abs(view->fruits[i].x - x) + abs(view->fruits[i].y - y);
+			d		   = fd < d ? fd : d;
+		}
+
+		if (d < best_d || (d == best_d && direction == view->direction))
+		{
+			best   = direction;
+			best_d = d;
+		}
+	}
+
+	return best;
+}
+
+const snake_bot_t snake_bot = {
+	.abi_version = SNAKE_BOT_ABI_VERSION,
+	.name		 = "greedy",
+	.decide		 = &decide,
+};
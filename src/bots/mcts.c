@@ -0,0 +1,703 @@
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <pthread.h>
+#include <snake_bot.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Monte Carlo tree search bot: every decision grows search trees of the
+// next moves within the time budget, finishing each new leaf with a fast
+// random playout, and plays the most visited move. Build it with
+// 'make bots' and play it with ./snake --bot bots/mcts.so
+//
+// Playouts run on their own model of the game, made to be copied many
+// thousand times per decision: one flat block without pointers holding
+// the occupancy bits, the body as a ring of cell indices, the fruits and
+// the random generator. Time is counted in moves instead of seconds and
+// nothing is drawn. A copy is two memcpy calls, sized by the board and
+// the snake length (a few hundred nanoseconds on the classic board).
+//
+// The search is root parallel: each thread grows its own tree from the
+// same position and the root visit counts are added up at the end, so
+// threads share nothing while they run. The threads start with the bot
+// and are parked on a barrier between decisions, a decision doesn't pay
+// for starting them. SNAKE_MCTS_THREADS overrides the number of threads
+// (default: one per CPU, up to MCTS_MAX_THREADS).
+
+#define MCTS_MAX_THREADS 8
+#define MCTS_MAX_NODES 65536	// per thread, the tree stops growing when full
+#define MCTS_MAX_FRUITS 8
+#define MCTS_FRUIT_TTL 100		// moves a fruit stays, the view doesn't tell
+#define MCTS_SPAWN_MOVES 30		// one new fruit every so many moves, on average
+#define MCTS_PLAYOUT_MOVES 16	// moves played past a new leaf
+#define MCTS_SURVIVAL 0.5f		// playout reward of surviving, eating adds the rest
+#define MCTS_GREEDY_PERCENT 80	// playout moves heading for the closest fruit
+#define MCTS_BUDGET_SHARE 70	// percent of the budget spent searching
+#define MCTS_EXPLORATION 0.7f	// UCT exploration constant
+#define MCTS_TIME_CHECK 16		// iterations between clock reads
+
+typedef struct game_t
+{
+	uint32_t rng; // xorshift32
+	uint16_t head;		   // ring index of the head
+	uint16_t length;	   // body cells
+	uint16_t moves;		   // since the search root
+	uint16_t first_eat;	   // moves to the first fruit eaten, 0: none
+	uint8_t	 direction;	   // snake_bot_direction_t
+	uint8_t	 fruits_length;
+	uint8_t	 digest_length;
+	bool	 dead;
+	uint16_t fruits[MCTS_MAX_FRUITS];	 // cells
+	uint16_t fruit_ttl[MCTS_MAX_FRUITS]; // moves left
+	uint16_t digest[MCTS_MAX_FRUITS];	 // moves until an eaten fruit grows the body
+	uint64_t bits[];					 // occupancy (walls and body), then the body ring
+} game_t;
+
+typedef struct node_t
+{
+	uint32_t children[4]; // node per direction - 1, 0: not expanded
+	uint32_t visits;
+	float	 value; // sum of the playout rewards
+} node_t;
+
+typedef struct worker_t
+{
+	pthread_t handle;
+	node_t	 *nodes;
+	uint32_t  nodes_length;
+	game_t	 *game;	 // scratch copy of the root
+	uint16_t *queue; // flood fill of the playout ends
+	uint32_t  rng;
+	uint32_t  iterations;
+} worker_t;
+
+static const int8_t	 dx[]		= { 0, -1, 1, 0, 0 };
+static const int8_t	 dy[]		= { 0, 0, 0, -1, 1 };
+static const uint8_t opposite[] = { 0, 2, 1, 4, 3 };
+
+static uint16_t	 size;		  // board size
+static uint32_t	 cells;		  // size * size, cell index is y * size + x
+static uint32_t	 bits_words;  // occupancy words
+static size_t	 state_size;  // game_t with its bits and ring
+static int32_t	 offsets[5];  // cell index delta per direction
+static game_t	*root = NULL; // position to decide from
+static worker_t	 workers[MCTS_MAX_THREADS];
+static uint8_t	 workers_length = 0;
+static uint64_t	 deadline;
+static uint32_t	 last_tick	 = 0;	 // of the previous decision
+static uint16_t	 last_fruits[MCTS_MAX_FRUITS];
+static uint8_t	 last_fruits_length = 0;
+static uint16_t	 digest[MCTS_MAX_FRUITS]; // the real snake's, see track_digest
+static uint8_t	 digest_length = 0;
+
+static pthread_barrier_t barrier;								 // decisions start and end on it
+static pthread_mutex_t	 pool_mutex = PTHREAD_MUTEX_INITIALIZER; // held while the pool starts
+static uint64_t			 finish_ns	= 0;						 // past the deadline lately, see decide
+static bool				 running	= false;
+
+static void		track_digest(const snake_bot_view_t *view);
+static void		game_copy(game_t *dest, const game_t *src);
+static void		game_step(game_t *game, uint8_t direction);
+static uint8_t	game_moves(const game_t *game);
+static void		game_spawn(game_t *game);
+static float	playout(game_t *game, uint16_t *queue, uint32_t *rng);
+static uint32_t game_space(game_t *game, uint16_t *queue, uint32_t limit);
+static void	   *work(void *arg);
+static void		search(worker_t *worker);
+static void		iterate(worker_t *worker);
+static uint32_t random_next(uint32_t *state);
+static uint64_t get_time_ns(void);
+
+#define GAME_RING(game) ((uint16_t *)((game)->bits + bits_words))
+#define GAME_TEST(game, cell) (((game)->bits[(cell) / 64] >> ((cell) % 64)) & 1)
+#define GAME_SET(game, cell) ((game)->bits[(cell) / 64] |= (uint64_t)1 << ((cell) % 64))
+#define GAME_CLEAR(game, cell) ((game)->bits[(cell) / 64] &= ~((uint64_t)1 << ((cell) % 64)))
+#define GAME_TAIL(game) (GAME_RING(game)[((game)->head + cells - (game)->length + 1) % cells])
+
+static void init(uint16_t board_size, uint32_t seed)
+{
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	long want = getenv("SNAKE_MCTS_THREADS") ? atol(getenv("SNAKE_MCTS_THREADS")) : cpus;
+
+	size	   = board_size;
+	cells	   = (uint32_t)size * size;
+	bits_words = (cells + 63) / 64;
+	state_size = sizeof(game_t) + bits_words * sizeof(uint64_t) + cells * sizeof(uint16_t);
+	offsets[1] = -1;
+	offsets[2] = 1;
+	offsets[3] = -(int32_t)size;
+	offsets[4] = size;
+	root	   = calloc(1, state_size);
+	want	   = want < 1 ? 1 : want > MCTS_MAX_THREADS ? MCTS_MAX_THREADS : want;
+
+	// the calling thread is the first worker, the pool stops growing on
+	// a thread that fails to start
+	pthread_mutex_lock(&pool_mutex);
+	running		   = true;
+	workers_length = 1;
+
+	while (workers_length < want && !pthread_create(&workers[workers_length].handle, NULL, &work, &workers[workers_length]))
+	{
+		workers_length++;
+	}
+
+	for (uint8_t i = 0; i < workers_length; i++)
+	{
+		workers[i].nodes = malloc(sizeof(node_t) * MCTS_MAX_NODES);
+		workers[i].game	 = calloc(1, state_size);
+		workers[i].queue = malloc(sizeof(uint16_t) * cells);
+		workers[i].rng	 = (seed ? seed : (uint32_t)time(NULL)) * 2654435761u + i + 1;
+	}
+
+	pthread_barrier_init(&barrier, NULL, workers_length);
+	pthread_mutex_unlock(&pool_mutex);
+}
+
+static void dispose(void)
+{
+	// the workers wait for the next decision, they find the pool stopped
+	running = false;
+	pthread_barrier_wait(&barrier);
+
+	for (uint8_t i = 1; i < workers_length; i++)
+	{
+		pthread_join(workers[i].handle, NULL);
+	}
+
+	pthread_barrier_destroy(&barrier);
+
+	for (uint8_t i = 0; i < workers_length; i++)
+	{
+		free(workers[i].nodes);
+		free(workers[i].game);
+		free(workers[i].queue);
+	}
+
+	free(root);
+	root		   = NULL;
+	workers_length = 0;
+}
+
+static uint8_t decide(const snake_bot_view_t *view, uint64_t budget_ns)
+{
+	uint64_t  start	   = get_time_ns();
+	uint32_t  visits[] = { 0, 0, 0, 0 };
+	uint16_t *ring	   = GAME_RING(root);
+	uint8_t	  best	   = SNAKE_BOT_KEEP;
+
+	// the root position, from the view
+	memset(root, 0, state_size);
+	track_digest(view);
+
+	for (uint16_t y = 0; y < size; y++)
+	{
+		for (uint16_t x = 0; x < size; x++)
+		{
+			if (view->cells[y * view->board_stride + x])
+			{
+				GAME_SET(root, y * size + x);
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < view->body_length; i++)
+	{
+		ring[view->body_length - 1 - i] = view->body[i].y * size + view->body[i].x;
+	}
+
+	for (uint32_t i = 0; i < view->fruits_length && i < MCTS_MAX_FRUITS; i++)
+	{
+		root->fruits[i]	   = view->fruits[i].y * size + view->fruits[i].x;
+		root->fruit_ttl[i] = MCTS_FRUIT_TTL;
+		root->fruits_length++;
+	}
+
+	root->head			= view->body_length - 1;
+	root->length		= view->body_length;
+	root->direction		= view->direction;
+	root->digest_length = digest_length;
+	memcpy(root->digest, digest, sizeof(digest));
+
+	// search on every worker, the calling thread being the first. What
+	// follows the deadline (the last iterations, the barrier, the merge)
+	// comes off the searching time.
+	uint64_t share = budget_ns * MCTS_BUDGET_SHARE / 100;
+
+	deadline = start + (finish_ns < share ? share - finish_ns : 0);
+	pthread_barrier_wait(&barrier);
+	search(&workers[0]);
+	pthread_barrier_wait(&barrier);
+
+	for (uint8_t i = 0; i < workers_length; i++)
+	{
+		for (uint8_t d = 0; d < 4; d++)
+		{
+			uint32_t child = workers[i].nodes[0].children[d];
+			visits[d] += child ? workers[i].nodes[child].visits : 0;
+		}
+	}
+
+	// most visited move, no search at all falls back on any legal one
+	uint8_t	 moves = game_moves(root);
+	uint32_t most  = 0;
+
+	for (uint8_t d = SNAKE_BOT_LEFT; d <= SNAKE_BOT_DOWN; d++)
+	{
+		if ((moves >> d & 1) && (best == SNAKE_BOT_KEEP || visits[d - 1] > most))
+		{
+			best = d;
+			most = visits[d - 1];
+		}
+	}
+
+	// decays slowly, a single slow finish keeps the next deadlines early for a while
+	uint64_t now  = get_time_ns();
+	uint64_t late = now > deadline ? now - deadline : 0;
+
+	finish_ns = late > finish_ns ? late : finish_ns - finish_ns / 16;
+
+	return best;
+}
+
+// The view doesn't tell whether the body is about to grow, but stepping
+// into the tail's cell kills the snake when it does: the fruits eaten
+// are found by comparing the head with the fruits of the last decision
+static void track_digest(const snake_bot_view_t *view)
+{
+	uint16_t head	= view->body[0].y * size + view->body[0].x;
+	uint32_t passed = view->tick - last_tick;
+
+	// a new game, or decisions missed: start over
+	if (view->tick <= last_tick)
+	{
+		digest_length	   = 0;
+		last_fruits_length = 0;
+	}
+
+	for (uint8_t i = 0; i < digest_length;)
+	{
+		if (digest[i] > passed)
+		{
+			digest[i++] -= passed;
+		}
+		else
+		{
+			digest[i] = digest[--digest_length];
+		}
+	}
+
+	for (uint8_t i = 0; i < last_fruits_length; i++)
+	{
+		if (last_fruits[i] == head && passed == 1 && digest_length < MCTS_MAX_FRUITS)
+		{
+			digest[digest_length++] = view->body_length;
+		}
+	}
+
+	last_tick		   = view->tick;
+	last_fruits_length = 0;
+
+	for (uint32_t i = 0; i < view->fruits_length && i < MCTS_MAX_FRUITS; i++)
+	{
+		last_fruits[last_fruits_length++] = view->fruits[i].y * size + view->fruits[i].x;
+	}
+}
+
+// worker threads, in lockstep with decide
+static void *work(void *arg)
+{
+	worker_t *worker = arg;
+
+	// the barrier is ready once the pool has started
+	pthread_mutex_lock(&pool_mutex);
+	pthread_mutex_unlock(&pool_mutex);
+
+	for (;;)
+	{
+		pthread_barrier_wait(&barrier);
+
+		if (!running)
+		{
+			return NULL;
+		}
+
+		search(worker);
+		pthread_barrier_wait(&barrier);
+	}
+}
+
+static void search(worker_t *worker)
+{
+	memset(&worker->nodes[0], 0, sizeof(node_t));
+	worker->nodes_length = 1;
+	worker->iterations	 = 0;
+
+	do
+	{
+		for (uint8_t i = 0; i < MCTS_TIME_CHECK; i++)
+		{
+			iterate(worker);
+		}
+	} while (get_time_ns() < deadline);
+}
+
+// one selection, expansion, playout and backup pass
+static void iterate(worker_t *worker)
+{
+	uint32_t path[MCTS_PLAYOUT_MOVES + 1];
+	uint8_t	 depth = 0;
+	uint32_t node  = 0;
+	game_t	*game  = worker->game;
+
+	game_copy(game, root);
+	game->rng	  = random_next(&worker->rng) | 1; // a different future every time
+	path[depth++] = node;
+
+	while (!game->dead && depth <= MCTS_PLAYOUT_MOVES)
+	{
+		uint8_t moves	 = game_moves(game);
+		uint8_t untried	 = 0;
+		uint8_t selected = 0;
+		float	best	 = -1;
+
+		if (!moves)
+		{
+			game->dead = true;
+			break;
+		}
+
+		for (uint8_t d = SNAKE_BOT_LEFT; d <= SNAKE_BOT_DOWN; d++)
+		{
+			if ((moves >> d & 1) && !worker->nodes[node].children[d - 1])
+			{
+				untried |= 1 << d;
+			}
+		}
+
+		// expand one untried move, unless the tree is full
+		if (untried && worker->nodes_length < MCTS_MAX_NODES)
+		{
+			uint32_t k = random_next(&worker->rng) % __builtin_popcount(untried);
+
+			for (; k; k--)
+			{
+				untried &= untried - 1;
+			}
+
+			uint8_t	 d	   = __builtin_ctz(untried);
+			uint32_t child = worker->nodes_length++;
+
+			memset(&worker->nodes[child], 0, sizeof(node_t));
+			worker->nodes[node].children[d - 1] = child;
+			game_step(game, d);
+			path[depth++] = child;
+			break;
+		}
+
+		if (untried)
+		{
+			break; // full tree: the playout starts here
+		}
+
+		// UCT over the expanded moves
+		float log_visits = logf(worker->nodes[node].visits + 1);
+
+		for (uint8_t d = SNAKE_BOT_LEFT; d <= SNAKE_BOT_DOWN; d++)
+		{
+			uint32_t child = worker->nodes[node].children[d - 1];
+
+			if (!(moves >> d & 1) || !child)
+			{
+				continue;
+			}
+
+			node_t *n	  = &worker->nodes[child];
+			float	score = n->visits ? n->value / n->visits + MCTS_EXPLORATION * sqrtf(log_visits / n->visits) : 2;
+
+			if (score > best)
+			{
+				best	 = score;
+				selected = d;
+			}
+		}
+
+		node = worker->nodes[node].children[selected - 1];
+		game_step(game, selected);
+		path[depth++] = node;
+	}
+
+	float reward = playout(game, worker->queue, &worker->rng);
+
+	for (uint8_t i = 0; i < depth; i++)
+	{
+		worker->nodes[path[i]].visits++;
+		worker->nodes[path[i]].value += reward;
+	}
+
+	worker->iterations++;
+}
+
+// Plays on with random safe moves, leaning towards the fruits. The
+// reward is in [0, 1]: surviving always beats dying later, and eating
+// early beats eating late.
+static float playout(game_t *game, uint16_t *queue, uint32_t *rng)
+{
+	uint16_t horizon = game->moves + MCTS_PLAYOUT_MOVES;
+
+	while (!game->dead && game->moves < horizon)
+	{
+		uint8_t moves = game_moves(game);
+
+		if (!moves)
+		{
+			game->dead = true;
+			break;
+		}
+
+		uint32_t r		   = random_next(rng);
+		uint8_t	 direction = 0;
+
+		// mostly the safe move closest to a fruit, sometimes any safe move
+		if (r % 100 < MCTS_GREEDY_PERCENT && game->fruits_length)
+		{
+			uint16_t head	= GAME_RING(game)[game->head];
+			int32_t	 best_d = INT32_MAX;
+
+			for (uint8_t d = SNAKE_BOT_LEFT; d <= SNAKE_BOT_DOWN; d++)
+			{
+				if (!(moves >> d & 1))
+				{
+					continue;
+				}
+
+				int32_t x = head % size + dx[d];
+				int32_t y = head / size + dy[d];
+
+				for (uint8_t i = 0; i < game->fruits_length; i++)
+				{
+					int32_t fd = abs(game->fruits[i] % size - x) + abs(game->fruits[i] / size - y);
+
+					if (fd < best_d)
+					{
+						best_d	  = fd;
+						direction = d;
+					}
+				}
+			}
+		}
+		else
+		{
+			uint32_t k = (r >> 8) % __builtin_popcount(moves);
+
+			for (; k; k--)
+			{
+				moves &= moves - 1;
+			}
+
+			direction = __builtin_ctz(moves);
+		}
+
+		game_step(game, direction);
+	}
+
+	if (game->dead)
+	{
+		return MCTS_SURVIVAL * game->moves / horizon;
+	}
+
+	// alive, but shut in a region smaller than the body: likely lost
+	if (game_space(game, queue, game->length) < game->length)
+	{
+		return MCTS_SURVIVAL / 2;
+	}
+
+	return MCTS_SURVIVAL + (game->first_eat ? (1 - MCTS_SURVIVAL) * (horizon - game->first_eat) / horizon : 0);
+}
+
+// the live part of the ring only, short snakes copy fast on any board
+static void game_copy(game_t *dest, const game_t *src)
+{
+	uint16_t	   *dest_ring = GAME_RING(dest);
+	const uint16_t *src_ring  = GAME_RING(src);
+	uint32_t		tail	  = (src->head + cells - src->length + 1) % cells;
+
+	memcpy(dest, src, sizeof(game_t) + bits_words * sizeof(uint64_t));
+
+	if (tail + src->length <= cells)
+	{
+		memcpy(dest_ring + tail, src_ring + tail, src->length * sizeof(uint16_t));
+	}
+	else
+	{
+		memcpy(dest_ring + tail, src_ring + tail, (cells - tail) * sizeof(uint16_t));
+		memcpy(dest_ring, src_ring, (src->head + 1) * sizeof(uint16_t));
+	}
+}
+
+// same rules as the game: the tail leaves before the head moves, and an
+// eaten fruit grows the body once the tail gets to its cell
+static void game_step(game_t *game, uint8_t direction)
+{
+	uint16_t *ring = GAME_RING(game);
+	uint16_t  next = ring[game->head] + offsets[direction];
+	bool	  grow = false;
+
+	for (uint8_t i = 0; i < game->digest_length;)
+	{
+		if (--game->digest[i] == 0)
+		{
+			grow			= true;
+			game->digest[i] = game->digest[--game->digest_length];
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	if (!grow)
+	{
+		GAME_CLEAR(game, GAME_TAIL(game));
+		game->length--;
+	}
+
+	game->moves++;
+	game->direction = direction;
+
+	if (GAME_TEST(game, next))
+	{
+		game->dead = true;
+		return;
+	}
+
+	GAME_SET(game, next);
+	game->head		 = (game->head + 1) % cells;
+	ring[game->head] = next;
+	game->length++;
+
+	for (uint8_t i = 0; i < game->fruits_length;)
+	{
+		if (game->fruits[i] == next && game->digest_length < MCTS_MAX_FRUITS)
+		{
+			game->digest[game->digest_length++] = game->length;
+			game->first_eat						= game->first_eat ? game->first_eat : game->moves;
+		}
+		else if (game->fruits[i] != next && --game->fruit_ttl[i])
+		{
+			i++;
+			continue;
+		}
+
+		// eaten or expired
+		game->fruits_length--;
+		game->fruits[i]	   = game->fruits[game->fruits_length];
+		game->fruit_ttl[i] = game->fruit_ttl[game->fruits_length];
+	}
+
+	game_spawn(game);
+}
+
+// bit per direction that doesn't hit a wall or the body, reversing
+// onto the neck is never one
+static uint8_t game_moves(const game_t *game)
+{
+	uint16_t head	= GAME_RING(game)[game->head];
+	uint16_t tail	= GAME_TAIL(game);
+	uint8_t	 moves	= 0;
+
+	for (uint8_t d = SNAKE_BOT_LEFT; d <= SNAKE_BOT_DOWN; d++)
+	{
+		uint16_t next = head + offsets[d];
+
+		// the tail cell frees up first, unless the body is about to grow
+		if ((game->length > 1 && d == opposite[game->direction]) ||
+			(GAME_TEST(game, next) && (next != tail || game->digest_length)))
+		{
+			continue;
+		}
+
+		moves |= 1 << d;
+	}
+
+	return moves;
+}
+
+// Free cells reachable from the head, counting stops at 'limit'. The
+// fill marks the cells it visits as occupied: only for playout ends.
+static uint32_t game_space(game_t *game, uint16_t *queue, uint32_t limit)
+{
+	uint32_t length = 0;
+	uint32_t count	= 0;
+
+	queue[length++] = GAME_RING(game)[game->head];
+
+	while (count < length && length <= limit)
+	{
+		uint16_t cell = queue[count++];
+
+		for (uint8_t d = SNAKE_BOT_LEFT; d <= SNAKE_BOT_DOWN; d++)
+		{
+			uint16_t next = cell + offsets[d];
+
+			if (!GAME_TEST(game, next))
+			{
+				GAME_SET(game, next);
+				queue[length++] = next;
+			}
+		}
+	}
+
+	return length - 1;
+}
+
+static void game_spawn(game_t *game)
+{
+	uint32_t r = random_next(&game->rng);
+
+	if (r % MCTS_SPAWN_MOVES || game->fruits_length == MCTS_MAX_FRUITS)
+	{
+		return;
+	}
+
+	// a few tries at a free cell, a crowded board spawns less
+	for (uint8_t i = 0; i < 4; i++)
+	{
+		uint32_t cell = random_next(&game->rng) % cells;
+
+		if (!GAME_TEST(game, cell))
+		{
+			game->fruits[game->fruits_length]	 = cell;
+			game->fruit_ttl[game->fruits_length] = MCTS_FRUIT_TTL;
+			game->fruits_length++;
+			return;
+		}
+	}
+}
+
+static uint32_t random_next(uint32_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+
+	return *state;
+}
+
+static uint64_t get_time_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+const snake_bot_t snake_bot = {
+	.abi_version = SNAKE_BOT_ABI_VERSION,
+	.name		 = "mcts",
+	.init		 = &init,
+	.decide		 = &decide,
+	.dispose	 = &dispose,
+};
@@ -19,11 +19,12 @@ void error_handler(const char *file, const char *function, int line, const char
 	exit(1);
 }
 
-void set_offset_yx(uint8_t height, uint8_t width, uint8_t *offset_y, uint8_t *offset_x)
+// centered on the terminal, at the top left corner when it doesn't fit
+void set_offset_yx(uint16_t height, uint16_t width, uint16_t *offset_y, uint16_t *offset_x)
 {
-	uint8_t rows, cols;
+	int rows, cols;
 	getmaxyx(stdscr, rows, cols);
 
-	*offset_y = (rows - height) * 0.5;
-	*offset_x = (cols - width) * 0.5;
+	*offset_y = rows > height ? (rows - height) / 2 : 0;
+	*offset_x = cols > width ? (cols - width) / 2 : 0;
 }
@@ -7,6 +7,6 @@ void error_handler(const char *file, const char *function, int line, const char
 
 #define ASSERT(exp) ((exp) ? 1 : error_handler(__FILE__, __FUNCTION__, __LINE__, #exp))
 
-void set_offset_yx(uint8_t height, uint8_t width, uint8_t *offset_y, uint8_t *offset_x);
+void set_offset_yx(uint16_t height, uint16_t width, uint16_t *offset_y, uint16_t *offset_x);
 
 #endif
\ No newline at end of file
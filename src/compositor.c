@@ -0,0 +1,182 @@
+#include "compositor.h"
+#include "common.h"
+#include "terminal.h"
+#include "trace.h"
+
+// Screens never refresh their windows themselves: they mark them as
+// damaged and the game loop presents the frame once. Damaged windows
+// are staged with wnoutrefresh from the lowest to the highest z and the
+// terminal gets a single doupdate, so a frame is one flush no matter how
+// many windows changed. A damaged window also restages the windows
+// stacked above it, which would otherwise be painted over.
+//
+// On slow links (--max-frame-bytes) the terminal output is counted and
+// each frame adds its byte budget to a credit. While the credit is used
+// up, windows with cosmetic damage only (blinking labels and the like)
+// are held back, they keep their damage and go out on a later frame.
+// Gameplay damage is always presented.
+
+typedef enum damage_t
+{
+	DAMAGE_NONE		= 0,
+	DAMAGE_COSMETIC = 1,
+	DAMAGE_REQUIRED = 2
+} damage_t;
+
+typedef struct layer_t
+{
+	WINDOW	*win;
+	int8_t	 z;
+	damage_t damage;
+} layer_t;
+
+static layer_t layers[COMPOSITOR_MAX_WINDOWS];
+static uint8_t layers_length = 0;
+static int64_t byte_budget	 = 0; // per frame, 0: unlimited
+static int64_t byte_credit	 = 0;
+static int64_t bytes_written = 0; // since the last present
+
+static bool overlap(WINDOW *a, WINDOW *b);
+static void damage(WINDOW *win, damage_t level);
+static void count_bytes(const void *data, size_t length);
+
+void compositor_add(WINDOW *win, int8_t z)
+{
+	ASSERT(win && layers_length < COMPOSITOR_MAX_WINDOWS);
+
+	// keep layers sorted by z, same z windows in insertion order
+	uint8_t i = layers_length++;
+
+	for (; i > 0 && layers[i - 1].z > z; i--)
+	{
+		layers[i] = layers[i - 1];
+	}
+
+	layers[i] = (layer_t) { .win = win, .z = z, .damage = DAMAGE_REQUIRED };
+}
+
+// pending damage is staged right away, so erasing a window before
+// removing it still clears its area on the next frame
+void compositor_remove(WINDOW *win)
+{
+	for (uint8_t i = 0; i < layers_length; i++)
+	{
+		if (layers[i].win == win)
+		{
+			if (layers[i].damage)
+			{
+				wnoutrefresh(win);
+			}
+
+			memmove(&layers[i], &layers[i + 1], (layers_length - i - 1) * sizeof(layer_t));
+			layers_length--;
+			return;
+		}
+	}
+}
+
+void compositor_damage(WINDOW *win)
+{
+	damage(win, DAMAGE_REQUIRED);
+}
+
+// the window only changed in looks, presenting it can wait
+void compositor_damage_cosmetic(WINDOW *win)
+{
+	damage(win, DAMAGE_COSMETIC);
+}
+
+void compositor_set_byte_budget(uint32_t bytes_per_frame)
+{
+	if (!byte_budget && bytes_per_frame)
+	{
+		terminal_add_sink(&count_bytes);
+	}
+	else if (byte_budget && !bytes_per_frame)
+	{
+		terminal_remove_sink(&count_bytes);
+	}
+
+	byte_budget = bytes_per_frame;
+	byte_credit = bytes_per_frame;
+}
+
+void compositor_present(void)
+{
+	uint8_t staged = 0;
+
+	if (byte_budget)
+	{
+		byte_credit -= bytes_written;
+		byte_credit += byte_budget;
+		bytes_written = 0;
+
+		if (byte_credit > byte_budget * COMPOSITOR_MAX_CREDIT_FRAMES)
+		{
+			byte_credit = byte_budget * COMPOSITOR_MAX_CREDIT_FRAMES;
+		}
+	}
+
+	bool hold_cosmetic = byte_budget && byte_credit <= 0;
+
+	for (uint8_t i = 0; i < layers_length; i++)
+	{
+		if (!layers[i].damage || (hold_cosmetic && layers[i].damage == DAMAGE_COSMETIC))
+		{
+			continue;
+		}
+
+		for (uint8_t j = i + 1; j < layers_length; j++)
+		{
+			if (layers[j].damage != DAMAGE_REQUIRED && overlap(layers[i].win, layers[j].win))
+			{
+				touchwin(layers[j].win);
+				layers[j].damage = DAMAGE_REQUIRED;
+			}
+		}
+
+		TRACE2(window_refresh, layers[i].win, layers[i].z);
+		wnoutrefresh(layers[i].win);
+		layers[i].damage = DAMAGE_NONE;
+		staged++;
+	}
+
+	if (staged)
+	{
+		TRACE1(doupdate_start, staged);
+		doupdate();
+		TRACE1(doupdate_end, staged);
+	}
+}
+
+static void damage(WINDOW *win, damage_t level)
+{
+	for (uint8_t i = 0; i < layers_length; i++)
+	{
+		if (layers[i].win == win)
+		{
+			layers[i].damage = level > layers[i].damage ? level : layers[i].damage;
+			return;
+		}
+	}
+
+	ASSERT(!"window not registered");
+}
+
+static void count_bytes(const void *data, size_t length)
+{
+	(void)data;
+	bytes_written += length;
+}
+
+static bool overlap(WINDOW *a, WINDOW *b)
+{
+	int a_y, a_x, a_rows, a_cols, b_y, b_x, b_rows, b_cols;
+	getbegyx(a, a_y, a_x);
+	getmaxyx(a, a_rows, a_cols);
+	getbegyx(b, b_y, b_x);
+	getmaxyx(b, b_rows, b_cols);
+
+	return a_x < b_x + b_cols && b_x < a_x + a_cols &&
+		   a_y < b_y + b_rows && b_y < a_y + a_rows;
+}
@@ -0,0 +1,16 @@
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+#include "defs.h"
+
+#define COMPOSITOR_MAX_WINDOWS 16
+#define COMPOSITOR_MAX_CREDIT_FRAMES 4 // unused byte budget saved for later frames
+
+void compositor_add(WINDOW *win, int8_t z);
+void compositor_remove(WINDOW *win);
+void compositor_damage(WINDOW *win);
+void compositor_damage_cosmetic(WINDOW *win);
+void compositor_set_byte_budget(uint32_t bytes_per_frame);
+void compositor_present(void);
+
+#endif
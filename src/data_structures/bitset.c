@@ -0,0 +1,127 @@
+#include "bitset.h"
+#include "../mem.h"
+
+static void	   tree_add(bitset_t *bitset, uint32_t word, int32_t val);
+static uint8_t select_in_word(uint64_t word, uint32_t k);
+
+bitset_t bitset_new(uint32_t bits)
+{
+	bitset_t bitset;
+
+	bitset.words_length = (bits + BITSET_WORD_BITS - 1) / BITSET_WORD_BITS;
+	bitset.count		= 0;
+	bitset.words		= mem_calloc(1, bitset.words_length * sizeof(uint64_t) + (bitset.words_length + 1) * sizeof(uint32_t));
+
+	ASSERT(bitset.words);
+
+	bitset.tree = (uint32_t *)(bitset.words + bitset.words_length);
+
+	return bitset;
+}
+
+void bitset_dispose(bitset_t *bitset)
+{
+	mem_free(bitset->words);
+	bitset->words = NULL;
+	bitset->tree  = NULL;
+}
+
+void bitset_set(bitset_t *bitset, uint32_t bit)
+{
+	uint64_t *word = &bitset->words[bit / BITSET_WORD_BITS];
+	uint64_t  mask = (uint64_t)1 << (bit % BITSET_WORD_BITS);
+
+	if (!(*word & mask))
+	{
+		*word |= mask;
+		bitset->count++;
+		tree_add(bitset, bit / BITSET_WORD_BITS, 1);
+	}
+}
+
+void bitset_clear(bitset_t *bitset, uint32_t bit)
+{
+	uint64_t *word = &bitset->words[bit / BITSET_WORD_BITS];
+	uint64_t  mask = (uint64_t)1 << (bit % BITSET_WORD_BITS);
+
+	if (*word & mask)
+	{
+		*word &= ~mask;
+		bitset->count--;
+		tree_add(bitset, bit / BITSET_WORD_BITS, -1);
+	}
+}
+
+// number of set bits before 'bit'
+uint32_t bitset_rank(const bitset_t *bitset, uint32_t bit)
+{
+	uint32_t word	= bit / BITSET_WORD_BITS;
+	uint64_t mask	= ((uint64_t)1 << (bit % BITSET_WORD_BITS)) - 1;
+	uint32_t result = __builtin_popcountll(bitset->words[word] & mask);
+
+	for (uint32_t i = word; i > 0; i -= i & -i)
+	{
+		result += bitset->tree[i];
+	}
+
+	return result;
+}
+
+// index of the k-th set bit (0-based), k must be lower than 'count'
+uint32_t bitset_select(const bitset_t *bitset, uint32_t k)
+{
+	uint32_t word = 0;
+	uint32_t step = 1;
+
+	while ((step << 1) <= bitset->words_length)
+	{
+		step <<= 1;
+	}
+
+	// Fenwick descent: find the last word whose prefix count is <= k
+	for (; step; step >>= 1)
+	{
+		if (word + step <= bitset->words_length && bitset->tree[word + step] <= k)
+		{
+			word += step;
+			k -= bitset->tree[word];
+		}
+	}
+
+	return word * BITSET_WORD_BITS + select_in_word(bitset->words[word], k);
+}
+
+void bitset_copy(bitset_t *dest, const bitset_t *src)
+{
+	ASSERT(dest->words_length == src->words_length);
+
+	memcpy(dest->words, src->words, src->words_length * sizeof(uint64_t) + (src->words_length + 1) * sizeof(uint32_t));
+	dest->count = src->count;
+}
+
+static void tree_add(bitset_t *bitset, uint32_t word, int32_t val)
+{
+	for (uint32_t i = word + 1; i <= bitset->words_length; i += i & -i)
+	{
+		bitset->tree[i] += val;
+	}
+}
+
+static uint8_t select_in_word(uint64_t word, uint32_t k)
+{
+	uint8_t offset = 0;
+
+	// skip whole bytes first, then the remaining bits one by one
+	for (uint8_t byte_count; k >= (byte_count = __builtin_popcount(word & 0xff)); word >>= 8)
+	{
+		k -= byte_count;
+		offset += 8;
+	}
+
+	for (; k; k--)
+	{
+		word &= word - 1;
+	}
+
+	return offset + __builtin_ctzll(word);
+}
@@ -0,0 +1,31 @@
+#ifndef BITSET_H
+#define BITSET_H
+
+#include "../common.h"
+#include "../defs.h"
+
+// Fixed size bit set with rank/select support.
+// A Fenwick tree over the per-word popcounts keeps prefix counts up to
+// date, so set/clear and selecting the k-th set bit are O(log words).
+// Words and tree live in a single block: copying a bitset of the same
+// size is one memcpy.
+typedef struct
+{
+	uint64_t *words;
+	uint32_t *tree; // 1-based Fenwick tree, tree[i] covers words (i - lowbit(i), i]
+	uint32_t  words_length;
+	uint32_t  count; // number of set bits
+} bitset_t;
+
+#define BITSET_WORD_BITS 64
+#define BITSET_TEST(bitset, bit) (((bitset).words[(bit) / BITSET_WORD_BITS] >> ((bit) % BITSET_WORD_BITS)) & 1)
+
+bitset_t bitset_new(uint32_t bits);
+void	 bitset_dispose(bitset_t *bitset);
+void	 bitset_set(bitset_t *bitset, uint32_t bit);
+void	 bitset_clear(bitset_t *bitset, uint32_t bit);
+uint32_t bitset_rank(const bitset_t *bitset, uint32_t bit);
+uint32_t bitset_select(const bitset_t *bitset, uint32_t k);
+void	 bitset_copy(bitset_t *dest, const bitset_t *src);
+
+#endif
@@ -1,7 +1,13 @@
 #ifndef DATA_STRUCTURES_H
 #define DATA_STRUCTURES_H
 
+#include "bitset.h"
+#include "flood_fill.h"
+#include "sparse_map.h"
 #include "sparse_set.h"
+#include "tile_map.h"
+#include "timer_wheel.h"
+#include "triple_buffer.h"
 #include "vector.h"
 
 #endif
\ No newline at end of file
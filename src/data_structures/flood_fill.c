@@ -0,0 +1,121 @@
+#include "flood_fill.h"
+
+static bool		fill_row(uint64_t *reach, const uint64_t *open, uint32_t rows, uint32_t row_words, uint32_t y, bool force);
+static uint64_t fill_up(uint64_t reach, uint64_t open);
+static uint64_t fill_down(uint64_t reach, uint64_t open);
+
+// returns the open cells reached
+uint32_t flood_fill(uint64_t *reach, const uint64_t *open, uint32_t rows, uint32_t row_words)
+{
+	uint32_t count	 = 0;
+	bool	 changed = true;
+	bool	 force	 = true; // the first sweep fills the seed rows on their own
+
+	while (changed)
+	{
+		changed = false;
+
+		for (uint32_t y = 0; y < rows; y++)
+		{
+			changed |= fill_row(reach, open, rows, row_words, y, force);
+		}
+
+		force = false;
+
+		for (uint32_t y = rows; y-- > 0;)
+		{
+			changed |= fill_row(reach, open, rows, row_words, y, false);
+		}
+	}
+
+	for (uint32_t i = 0; i < rows * row_words; i++)
+	{
+		count += __builtin_popcountll(reach[i] & open[i]);
+	}
+
+	return count;
+}
+
+// pulls the row's neighbours in and fills its open runs, true if it grew
+static bool fill_row(uint64_t *reach, const uint64_t *open, uint32_t rows, uint32_t row_words, uint32_t y, bool force)
+{
+	uint64_t	   *row		 = reach + y * row_words;
+	const uint64_t *above	 = y > 0 ? row - row_words : NULL;
+	const uint64_t *below	 = y + 1 < rows ? row + row_words : NULL;
+	const uint64_t *row_open = open + y * row_words;
+	uint64_t		grown	 = 0;
+
+	for (uint32_t w = 0; w < row_words; w++)
+	{
+		uint64_t neighbours = (above ? above[w] : 0) | (below ? below[w] : 0);
+		uint64_t entered	= neighbours & row_open[w] & ~row[w];
+
+		row[w] |= entered;
+		grown |= entered;
+	}
+
+	if (!grown && !force)
+	{
+		return false;
+	}
+
+	// runs can cross word boundaries: carry the edge bit to the next word
+	// up, then back down
+	uint64_t carry = 0;
+
+	for (uint32_t w = 0; w < row_words; w++)
+	{
+		uint64_t before = row[w];
+		row[w]			= fill_up(row[w] | (carry & row_open[w]), row_open[w]);
+		carry			= row[w] >> 63;
+		grown |= row[w] ^ before;
+	}
+
+	carry = 0;
+
+	for (uint32_t w = row_words; w-- > 0;)
+	{
+		uint64_t before = row[w];
+		row[w]			= fill_down(row[w] | ((carry << 63) & row_open[w]), row_open[w]);
+		carry			= row[w] & 1;
+		grown |= row[w] ^ before;
+	}
+
+	return grown != 0;
+}
+
+// Kogge-Stone occluded fill: every set bit spreads to the higher bits of
+// its open run in log2(64) steps, 'open' halving its runs as they're covered
+static uint64_t fill_up(uint64_t reach, uint64_t open)
+{
+	reach |= open & (reach << 1);
+	open &= open << 1;
+	reach |= open & (reach << 2);
+	open &= open << 2;
+	reach |= open & (reach << 4);
+	open &= open << 4;
+	reach |= open & (reach << 8);
+	open &= open << 8;
+	reach |= open & (reach << 16);
+	open &= open << 16;
+	reach |= open & (reach << 32);
+
+	return reach;
+}
+
+static uint64_t fill_down(uint64_t reach, uint64_t open)
+{
+	reach |= open & (reach >> 1);
+	open &= open >> 1;
+	reach |= open & (reach >> 2);
+	open &= open >> 2;
+	reach |= open & (reach >> 4);
+	open &= open >> 4;
+	reach |= open & (reach >> 8);
+	open &= open >> 8;
+	reach |= open & (reach >> 16);
+	open &= open >> 16;
+	reach |= open & (reach >> 32);
+
+	return reach;
+}
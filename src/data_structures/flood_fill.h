@@ -0,0 +1,17 @@
+#ifndef FLOOD_FILL_H
+#define FLOOD_FILL_H
+
+#include "../common.h"
+#include "../defs.h"
+
+// Flood fill over a packed bit grid: 'rows' rows of 'row_words' 64-bit
+// words each, bit x of a row is column x. The seeds set on 'reach'
+// spread to their 4-neighbours set on 'open' until nothing changes;
+// seeds don't need to be open themselves.
+// Rows are filled whole words at a time instead of cell by cell: an
+// open run along a row is filled with a few shifts and masks, and rows
+// are swept top-down then bottom-up so a corridor going either way is
+// crossed in a single sweep. Columns past the grid width must be closed.
+uint32_t flood_fill(uint64_t *reach, const uint64_t *open, uint32_t rows, uint32_t row_words);
+
+#endif
@@ -0,0 +1,140 @@
+#include "sparse_map.h"
+#include "../mem.h"
+
+static void fit_payloads(sparse_map_t *map);
+
+sparse_map_t sparse_map_new(uint32_t chunk_size, uint32_t payload_size)
+{
+	sparse_map_t map;
+
+	map.set				  = sparse_set_new(chunk_size);
+	map.payloads		  = NULL;
+	map.payload_size	  = payload_size;
+	map.payloads_capacity = 0;
+	map.generations		  = mem_calloc(chunk_size, sizeof(uint32_t));
+
+	ASSERT(map.generations);
+
+	return map;
+}
+
+void sparse_map_dispose(sparse_map_t *map)
+{
+	sparse_set_dispose(&map->set);
+	mem_free(map->payloads);
+	mem_free(map->generations);
+	map->payloads	 = NULL;
+	map->generations = NULL;
+}
+
+// room for 'capacity' ids without allocating, e.g. before a loop that
+// must not allocate
+void sparse_map_reserve(sparse_map_t *map, uint32_t capacity)
+{
+	VECTOR_RESERVE(map->set.dense, capacity);
+	fit_payloads(map);
+}
+
+// payload of 'id', zeroed when the id is new
+void *sparse_map_put(sparse_map_t *map, uint32_t id)
+{
+	int32_t index = SPARSE_SET_INDEXOF(map->set, id);
+
+	if (index >= 0)
+	{
+		return SPARSE_MAP_AT(*map, void, index);
+	}
+
+	uint32_t sparse_size = map->set.sparse_size;
+	sparse_set_add(&map->set, id);
+
+	// the id buffers grow together, new ids start at generation 0
+	if (map->set.sparse_size > sparse_size)
+	{
+		uint32_t *temp = (uint32_t *)mem_realloc(map->generations, sizeof(uint32_t) * map->set.sparse_size);
+
+		ASSERT(temp);
+
+		memset(temp + sparse_size, 0, sizeof(uint32_t) * (map->set.sparse_size - sparse_size));
+		map->generations = temp;
+	}
+
+	fit_payloads(map);
+
+	index = map->set.sparse[id];
+	memset(SPARSE_MAP_AT(*map, void, index), 0, map->payload_size);
+
+	return SPARSE_MAP_AT(*map, void, index);
+}
+
+void *sparse_map_get(const sparse_map_t *map, uint32_t id)
+{
+	int32_t index = SPARSE_SET_INDEXOF(map->set, id);
+
+	return index >= 0 ? SPARSE_MAP_AT(*map, void, index) : NULL;
+}
+
+void sparse_map_remove(sparse_map_t *map, uint32_t id)
+{
+	int32_t index = SPARSE_SET_INDEXOF(map->set, id);
+
+	if (index < 0)
+	{
+		return;
+	}
+
+	// the set moves its last id into the hole, the payload follows
+	uint32_t last = SPARSE_MAP_LENGTH(*map) - 1;
+
+	if ((uint32_t)index < last)
+	{
+		memcpy(SPARSE_MAP_AT(*map, void, index), SPARSE_MAP_AT(*map, void, last), map->payload_size);
+	}
+
+	sparse_set_remove(&map->set, id);
+	map->generations[id]++;
+}
+
+void sparse_map_clear(sparse_map_t *map)
+{
+	uint32_t length = SPARSE_MAP_LENGTH(*map);
+
+	for (uint32_t i = 0; i < length; i++)
+	{
+		map->generations[SPARSE_MAP_ID_AT(*map, i)]++;
+	}
+
+	sparse_set_clear(&map->set);
+}
+
+sparse_map_handle_t sparse_map_handle(const sparse_map_t *map, uint32_t id)
+{
+	ASSERT(SPARSE_MAP_CONTAINS(*map, id));
+
+	return (sparse_map_handle_t) { .id = id, .generation = map->generations[id] };
+}
+
+// payload of the handle's id, NULL if it was removed since
+void *sparse_map_resolve(const sparse_map_t *map, sparse_map_handle_t handle)
+{
+	if (!SPARSE_MAP_CONTAINS(*map, handle.id) || map->generations[handle.id] != handle.generation)
+	{
+		return NULL;
+	}
+
+	return SPARSE_MAP_AT(*map, void, map->set.sparse[handle.id]);
+}
+
+// payloads follow the capacity of the dense ids
+static void fit_payloads(sparse_map_t *map)
+{
+	if (map->payloads_capacity < VECTOR_SIZE(map->set.dense))
+	{
+		uint8_t *temp = (uint8_t *)mem_realloc(map->payloads, (size_t)map->payload_size * VECTOR_SIZE(map->set.dense));
+
+		ASSERT(temp);
+
+		map->payloads		   = temp;
+		map->payloads_capacity = VECTOR_SIZE(map->set.dense);
+	}
+}
@@ -0,0 +1,46 @@
+#ifndef SPARSE_MAP_H
+#define SPARSE_MAP_H
+
+#include "../common.h"
+#include "../defs.h"
+#include "sparse_set.h"
+
+// Sparse set with a fixed size payload per id. Payloads are stored
+// densely in the same order as the ids and move together with them
+// when an id is removed, so iterating the map walks two packed arrays.
+// Payload pointers are only valid until the next put or remove; keep a
+// handle (or the id) instead. A handle goes stale once its id is
+// removed, even if the id is put again later.
+typedef struct
+{
+	sparse_set_t set;
+	uint8_t		*payloads; // dense, set.dense order
+	uint32_t	 payload_size;
+	uint32_t	 payloads_capacity;
+	uint32_t	*generations; // per id, bumped on removal
+} sparse_map_t;
+
+typedef struct
+{
+	uint32_t id;
+	uint32_t generation;
+} sparse_map_handle_t;
+
+#define SPARSE_MAP_CONTAINS(map, id) SPARSE_SET_CONTAINS((map).set, id)
+#define SPARSE_MAP_LENGTH(map) VECTOR_LENGTH((map).set.dense)
+#define SPARSE_MAP_ID_AT(map, index) ((map).set.dense[index])
+#define SPARSE_MAP_AT(map, type, index) ((type *)((map).payloads + (size_t)(index) * (map).payload_size))
+#define SPARSE_MAP_GET(map, type, id) ((type *)sparse_map_get(&(map), id))
+#define SPARSE_MAP_PUT(map, type, id, val) (*(type *)sparse_map_put(&(map), id) = (val))
+
+sparse_map_t		sparse_map_new(uint32_t chunk_size, uint32_t payload_size);
+void				sparse_map_dispose(sparse_map_t *map);
+void				sparse_map_reserve(sparse_map_t *map, uint32_t capacity);
+void			   *sparse_map_put(sparse_map_t *map, uint32_t id);
+void			   *sparse_map_get(const sparse_map_t *map, uint32_t id);
+void				sparse_map_remove(sparse_map_t *map, uint32_t id);
+void				sparse_map_clear(sparse_map_t *map);
+sparse_map_handle_t sparse_map_handle(const sparse_map_t *map, uint32_t id);
+void			   *sparse_map_resolve(const sparse_map_t *map, sparse_map_handle_t handle);
+
+#endif
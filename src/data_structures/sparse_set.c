@@ -1,4 +1,6 @@
 #include "sparse_set.h"
+#include "../mem.h"
+#include "../trace.h"
 
 sparse_set_t sparse_set_new(uint32_t chunk_size)
 {
@@ -6,7 +8,7 @@ sparse_set_t sparse_set_new(uint32_t chunk_size)
 
 	sparse_set.chunk_size  = chunk_size;
 	sparse_set.dense	   = 0;
-	sparse_set.sparse	   = (uint32_t *)malloc(chunk_size * sizeof(uint32_t));
+	sparse_set.sparse	   = (uint32_t *)mem_alloc(chunk_size * sizeof(uint32_t));
 	sparse_set.sparse_size = chunk_size;
 
 	ASSERT(sparse_set.sparse);
@@ -17,7 +19,7 @@ sparse_set_t sparse_set_new(uint32_t chunk_size)
 void sparse_set_dispose(sparse_set_t *sparse_set)
 {
 	VECTOR_DISPOSE(sparse_set->dense);
-	free(sparse_set->sparse);
+	mem_free(sparse_set->sparse);
 	sparse_set->sparse = NULL;
 }
 
@@ -33,9 +35,10 @@ void sparse_set_add(sparse_set_t *sparse_set, uint32_t id)
 		}
 
 		size_needed += sparse_set->sparse_size;
-		uint32_t *temp = (uint32_t *)realloc(sparse_set->sparse, sizeof(uint32_t) * size_needed);
+		uint32_t *temp = (uint32_t *)mem_realloc(sparse_set->sparse, sizeof(uint32_t) * size_needed);
 
 		ASSERT(temp);
+		TRACE2(sparse_set_grow, sparse_set->sparse_size, size_needed);
 
 		sparse_set->sparse		= temp;
 		sparse_set->sparse_size = size_needed;
@@ -65,7 +68,7 @@ void sparse_set_remove(sparse_set_t *sparse_set, uint32_t id)
 	}
 
 	sparse_set->sparse[id] = 0;
-	VECTOR_REMOVE(sparse_set->dense, index);
+	VECTOR_SWAP_REMOVE(sparse_set->dense, index);
 }
 
 uint32_t sparse_set_pop(sparse_set_t *sparse_set)
@@ -0,0 +1,320 @@
+#include "tile_map.h"
+#include "../mem.h"
+
+#define TILE_MAP_OFFSET(x, y) ((((y) & (TILE_MAP_SIZE - 1)) << TILE_MAP_SHIFT) | ((x) & (TILE_MAP_SIZE - 1)))
+#define TILE_MAP_COMPRESS_COUNT (TILE_MAP_CELLS / 8) // compressed, a tile takes a quarter of its cells at most
+
+static tile_map_tile_t *find(tile_map_t *map, int32_t x, int32_t y);
+static tile_map_tile_t *insert(tile_map_t *map, int32_t x, int32_t y);
+static uint32_t			home(const tile_map_t *map, int32_t x, int32_t y);
+static void				remove_at(tile_map_t *map, uint32_t slot);
+static void				grow(tile_map_t *map);
+static void				compress(tile_map_t *map, tile_map_tile_t *tile);
+static void				decompress(tile_map_t *map, tile_map_tile_t *tile);
+static void				release(tile_map_t *map, tile_map_tile_t *tile);
+
+// room for 'capacity' tiles before the table grows
+tile_map_t tile_map_new(uint32_t capacity)
+{
+	tile_map_t map = { .capacity = 16 };
+
+	while (map.capacity < capacity * 2)
+	{
+		map.capacity <<= 1;
+	}
+
+	map.tiles = mem_calloc(map.capacity, sizeof(tile_map_tile_t));
+	ASSERT(map.tiles);
+
+	return map;
+}
+
+void tile_map_dispose(tile_map_t *map)
+{
+	for (uint32_t slot = 0; slot < map->capacity; slot++)
+	{
+		if (map->tiles[slot].used)
+		{
+			release(map, &map->tiles[slot]);
+		}
+	}
+
+	mem_free(map->tiles);
+	memset(map, 0, sizeof(tile_map_t));
+}
+
+uint8_t tile_map_get(tile_map_t *map, int32_t x, int32_t y)
+{
+	tile_map_tile_t *tile	= find(map, x >> TILE_MAP_SHIFT, y >> TILE_MAP_SHIFT);
+	uint16_t		 offset = TILE_MAP_OFFSET(x, y);
+
+	if (!tile)
+	{
+		return 0;
+	}
+
+	if (tile->cells)
+	{
+		return tile->cells[offset];
+	}
+
+	uint32_t low = 0, high = tile->count;
+
+	while (low < high)
+	{
+		uint32_t middle = (low + high) / 2;
+		uint16_t at		= tile->packed[middle] >> 4;
+
+		if (at == offset)
+		{
+			return tile->packed[middle] & TILE_MAP_MAX_VALUE;
+		}
+
+		if (at < offset)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+
+	return 0;
+}
+
+// a nonzero value allocates the tile, clearing a cell never does
+void tile_map_set(tile_map_t *map, int32_t x, int32_t y, uint8_t value)
+{
+	ASSERT(value <= TILE_MAP_MAX_VALUE);
+
+	tile_map_tile_t *tile = find(map, x >> TILE_MAP_SHIFT, y >> TILE_MAP_SHIFT);
+
+	if (!tile)
+	{
+		if (!value)
+		{
+			return;
+		}
+
+		tile = insert(map, x >> TILE_MAP_SHIFT, y >> TILE_MAP_SHIFT);
+	}
+
+	if (!tile->cells)
+	{
+		decompress(map, tile);
+	}
+
+	uint8_t *cell = &tile->cells[TILE_MAP_OFFSET(x, y)];
+
+	tile->count += (value != 0) - (*cell != 0);
+	tile->written = map->now;
+	*cell		  = value;
+}
+
+// Tiles not written for 'cold' ticks: evicted when they're all zeros,
+// compressed when they're sparse.
+void tile_map_sweep(tile_map_t *map, uint64_t cold)
+{
+	uint32_t slot = 0;
+
+	while (slot < map->capacity)
+	{
+		tile_map_tile_t *tile = &map->tiles[slot];
+
+		if (!tile->used || map->now - tile->written < cold)
+		{
+			slot++;
+			continue;
+		}
+
+		// the next tiles of the probe sequence may move back to this slot,
+		// it's checked again
+		if (!tile->count)
+		{
+			release(map, tile);
+			remove_at(map, slot);
+			map->evicted++;
+			continue;
+		}
+
+		if (tile->cells && tile->count <= TILE_MAP_COMPRESS_COUNT)
+		{
+			compress(map, tile);
+		}
+
+		slot++;
+	}
+}
+
+// tile coordinates, NULL when the tile isn't allocated
+static tile_map_tile_t *find(tile_map_t *map, int32_t x, int32_t y)
+{
+	if (map->last && map->last->x == x && map->last->y == y)
+	{
+		return map->last;
+	}
+
+	// the table is at most half full, probes end on a free slot
+	for (uint32_t slot = home(map, x, y);; slot = (slot + 1) & (map->capacity - 1))
+	{
+		tile_map_tile_t *tile = &map->tiles[slot];
+
+		if (!tile->used)
+		{
+			return NULL;
+		}
+
+		if (tile->x == x && tile->y == y)
+		{
+			return map->last = tile;
+		}
+	}
+}
+
+static tile_map_tile_t *insert(tile_map_t *map, int32_t x, int32_t y)
+{
+	if ((map->length + 1) * 2 > map->capacity)
+	{
+		grow(map);
+	}
+
+	uint32_t slot = home(map, x, y);
+
+	while (map->tiles[slot].used)
+	{
+		slot = (slot + 1) & (map->capacity - 1);
+	}
+
+	tile_map_tile_t *tile = &map->tiles[slot];
+
+	*tile		= (tile_map_tile_t) { .x = x, .y = y, .used = true, .written = map->now };
+	tile->cells = mem_calloc(TILE_MAP_CELLS, sizeof(uint8_t));
+	ASSERT(tile->cells);
+
+	map->bytes += TILE_MAP_CELLS;
+	map->length++;
+
+	return map->last = tile;
+}
+
+// Fibonacci hashing of the tile coordinates
+static uint32_t home(const tile_map_t *map, int32_t x, int32_t y)
+{
+	uint64_t key = (uint64_t)(uint32_t)x << 32 | (uint32_t)y;
+
+	return (key * 0x9e3779b97f4a7c15ULL) >> (64 - __builtin_ctz(map->capacity));
+}
+
+// Backward shift deletion: the next tiles of the probe sequence move
+// back into the hole, unless their home slot comes after it. No
+// tombstones, lookups stay as short as if the tile never was.
+static void remove_at(tile_map_t *map, uint32_t slot)
+{
+	uint32_t mask = map->capacity - 1;
+	uint32_t next = slot;
+
+	while (map->tiles[next = (next + 1) & mask].used)
+	{
+		tile_map_tile_t *tile = &map->tiles[next];
+
+		if (((next - home(map, tile->x, tile->y)) & mask) >= ((next - slot) & mask))
+		{
+			map->tiles[slot] = *tile;
+			slot			 = next;
+		}
+	}
+
+	map->tiles[slot].used = false;
+	map->length--;
+	map->last = NULL;
+}
+
+static void grow(tile_map_t *map)
+{
+	tile_map_tile_t *tiles	  = map->tiles;
+	uint32_t		 capacity = map->capacity;
+
+	map->capacity = capacity * 2;
+	map->tiles	  = mem_calloc(map->capacity, sizeof(tile_map_tile_t));
+	map->last	  = NULL;
+	ASSERT(map->tiles);
+
+	for (uint32_t i = 0; i < capacity; i++)
+	{
+		if (!tiles[i].used)
+		{
+			continue;
+		}
+
+		uint32_t slot = home(map, tiles[i].x, tiles[i].y);
+
+		while (map->tiles[slot].used)
+		{
+			slot = (slot + 1) & (map->capacity - 1);
+		}
+
+		map->tiles[slot] = tiles[i];
+	}
+
+	mem_free(tiles);
+}
+
+static void compress(tile_map_t *map, tile_map_tile_t *tile)
+{
+	uint16_t *packed = mem_alloc(sizeof(uint16_t) * tile->count);
+	uint16_t  length = 0;
+
+	ASSERT(packed);
+
+	for (uint16_t offset = 0; offset < TILE_MAP_CELLS; offset++)
+	{
+		if (tile->cells[offset])
+		{
+			packed[length++] = offset << 4 | tile->cells[offset];
+		}
+	}
+
+	mem_free(tile->cells);
+	tile->cells	 = NULL;
+	tile->packed = packed;
+	map->bytes -= TILE_MAP_CELLS - sizeof(uint16_t) * tile->count;
+	map->compressed++;
+}
+
+static void decompress(tile_map_t *map, tile_map_tile_t *tile)
+{
+	uint8_t *cells = mem_calloc(TILE_MAP_CELLS, sizeof(uint8_t));
+
+	ASSERT(cells);
+
+	for (uint16_t i = 0; i < tile->count; i++)
+	{
+		cells[tile->packed[i] >> 4] = tile->packed[i] & TILE_MAP_MAX_VALUE;
+	}
+
+	mem_free(tile->packed);
+	tile->packed = NULL;
+	tile->cells	 = cells;
+	map->bytes += TILE_MAP_CELLS - sizeof(uint16_t) * tile->count;
+	map->compressed--;
+}
+
+// the cells of the tile, dense or compressed
+static void release(tile_map_t *map, tile_map_tile_t *tile)
+{
+	if (tile->cells)
+	{
+		map->bytes -= TILE_MAP_CELLS;
+	}
+	else
+	{
+		map->bytes -= sizeof(uint16_t) * tile->count;
+		map->compressed--;
+	}
+
+	mem_free(tile->cells);
+	mem_free(tile->packed);
+	tile->cells	 = NULL;
+	tile->packed = NULL;
+}
@@ -0,0 +1,53 @@
+#ifndef TILE_MAP_H
+#define TILE_MAP_H
+
+#include "../common.h"
+#include "../defs.h"
+
+// Sparse, unbounded grid of small values (0..TILE_MAP_MAX_VALUE) made of
+// square tiles allocated on the first nonzero write, so memory follows
+// the area in use instead of the extent of the grid. Cells outside the
+// allocated tiles read 0.
+// Tiles are kept in an open addressing hash table keyed by tile
+// coordinate, and the last tile looked up is cached: walking along
+// neighbouring cells mostly skips the table.
+// A tile not written for a while is cold. tile_map_sweep evicts the cold
+// tiles left without any nonzero cell, and compresses the sparse ones
+// into a sorted list of their nonzero cells. Reads search the list, the
+// next write decompresses the tile.
+
+#define TILE_MAP_SHIFT 6
+#define TILE_MAP_SIZE (1 << TILE_MAP_SHIFT) // cells per tile side
+#define TILE_MAP_CELLS (TILE_MAP_SIZE * TILE_MAP_SIZE)
+#define TILE_MAP_MAX_VALUE 15 // values fit the low bits of a compressed cell
+
+typedef struct
+{
+	int32_t	  x; // tile coordinates, cell coordinates >> TILE_MAP_SHIFT
+	int32_t	  y;
+	uint8_t	 *cells;   // TILE_MAP_CELLS, NULL while compressed
+	uint16_t *packed;  // compressed: cell offset << 4 | value per nonzero cell, ascending
+	uint16_t  count;   // nonzero cells
+	bool	  used;	   // hash table slot
+	uint64_t  written; // tick of the last write
+} tile_map_tile_t;
+
+typedef struct
+{
+	tile_map_tile_t *tiles;		 // hash table, linear probing
+	tile_map_tile_t *last;		 // last tile looked up, NULL after a table change
+	uint32_t		 capacity;	 // power of two
+	uint32_t		 length;	 // tiles
+	uint32_t		 compressed; // compressed tiles
+	uint64_t		 bytes;		 // cells and compressed cells
+	uint64_t		 evicted;	 // tiles evicted, total
+	uint64_t		 now;		 // tick, set by the caller, stamps the writes
+} tile_map_t;
+
+tile_map_t tile_map_new(uint32_t capacity);
+void	   tile_map_dispose(tile_map_t *map);
+uint8_t	   tile_map_get(tile_map_t *map, int32_t x, int32_t y);
+void	   tile_map_set(tile_map_t *map, int32_t x, int32_t y, uint8_t value);
+void	   tile_map_sweep(tile_map_t *map, uint64_t cold);
+
+#endif
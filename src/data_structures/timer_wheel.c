@@ -0,0 +1,241 @@
+#include "timer_wheel.h"
+#include "../mem.h"
+
+#define LEVEL_SHIFT(level) ((level)*TIMER_WHEEL_SLOT_BITS)
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+#define SPAN ((uint64_t)1 << LEVEL_SHIFT(TIMER_WHEEL_LEVELS)) // ticks covered by all the levels
+
+static void link_timer(timer_wheel_t *wheel, uint32_t id);
+static void unlink_timer(timer_wheel_t *wheel, uint32_t id);
+static void free_timer(timer_wheel_t *wheel, uint32_t id);
+static void grow(timer_wheel_t *wheel, uint32_t capacity);
+static void tick(timer_wheel_t *wheel, timer_wheel_expire_t expire);
+
+timer_wheel_t timer_wheel_new(uint32_t capacity)
+{
+	timer_wheel_t wheel = { .timers = NULL, .capacity = 0, .free = TIMER_WHEEL_NONE };
+
+	memset(wheel.slots, 0xff, sizeof(wheel.slots)); // TIMER_WHEEL_NONE
+	grow(&wheel, capacity ? capacity : 1);
+
+	return wheel;
+}
+
+void timer_wheel_dispose(timer_wheel_t *wheel)
+{
+	mem_free(wheel->timers);
+	wheel->timers	= NULL;
+	wheel->capacity = 0;
+}
+
+// expires 'delay' ticks from now, at least one
+uint32_t timer_wheel_add(timer_wheel_t *wheel, uint64_t delay, uint32_t payload)
+{
+	if (wheel->free == TIMER_WHEEL_NONE)
+	{
+		grow(wheel, wheel->capacity * 2);
+	}
+
+	uint32_t			 id	   = wheel->free;
+	timer_wheel_timer_t *timer = &wheel->timers[id];
+
+	wheel->free		= timer->next;
+	timer->deadline = wheel->now + (delay ? delay : 1);
+	timer->payload	= payload;
+	wheel->length++;
+	link_timer(wheel, id);
+
+	return id;
+}
+
+void timer_wheel_cancel(timer_wheel_t *wheel, uint32_t id)
+{
+	ASSERT(id < wheel->capacity && wheel->timers[id].level < TIMER_WHEEL_LEVELS);
+
+	unlink_timer(wheel, id);
+	free_timer(wheel, id);
+}
+
+// cancels every timer, the clock keeps going
+void timer_wheel_clear(timer_wheel_t *wheel)
+{
+	for (uint8_t level = 0; level < TIMER_WHEEL_LEVELS; level++)
+	{
+		while (wheel->occupied[level])
+		{
+			uint8_t slot = __builtin_ctzll(wheel->occupied[level]);
+
+			while (wheel->slots[level][slot] != TIMER_WHEEL_NONE)
+			{
+				uint32_t id = wheel->slots[level][slot];
+				unlink_timer(wheel, id);
+				free_timer(wheel, id);
+			}
+		}
+	}
+}
+
+// Ticks until the next timer expires, TIMER_WHEEL_NEVER without timers.
+// Exact when it's on the lowest level, otherwise the time its slot is
+// entered: never later than the expiry, ask again once there.
+uint64_t timer_wheel_next(const timer_wheel_t *wheel)
+{
+	uint64_t next = TIMER_WHEEL_NEVER;
+
+	for (uint8_t level = 0; level < TIMER_WHEEL_LEVELS; level++)
+	{
+		if (!wheel->occupied[level])
+		{
+			continue;
+		}
+
+		// first occupied slot after the current one, the current one last:
+		// it holds a full turn ahead if anything
+		uint8_t	 shift	 = LEVEL_SHIFT(level);
+		uint8_t	 from	 = ((wheel->now >> shift) + 1) & SLOT_MASK;
+		uint64_t rotated = from ? (wheel->occupied[level] >> from) | (wheel->occupied[level] << (TIMER_WHEEL_SLOTS - from)) : wheel->occupied[level];
+		uint64_t at		 = ((wheel->now >> shift) + 1 + __builtin_ctzll(rotated)) << shift;
+
+		next = at - wheel->now < next ? at - wheel->now : next;
+	}
+
+	return next;
+}
+
+// Moves the clock 'ticks' ahead, calling 'expire' with the payload of
+// every timer due on the way, in deadline order. The callback can add and
+// cancel timers.
+void timer_wheel_advance(timer_wheel_t *wheel, uint64_t ticks, timer_wheel_expire_t expire)
+{
+	uint64_t target = wheel->now + ticks;
+
+	while (wheel->now < target)
+	{
+		// nothing happens before the next deadline
+		uint64_t next = timer_wheel_next(wheel);
+
+		if (next == TIMER_WHEEL_NEVER || next > target - wheel->now)
+		{
+			wheel->now = target;
+			return;
+		}
+
+		wheel->now += next - 1;
+		tick(wheel, expire);
+	}
+}
+
+static void tick(timer_wheel_t *wheel, timer_wheel_expire_t expire)
+{
+	uint64_t now = ++wheel->now;
+	uint8_t	 top = 0;
+
+	// slots entered on the upper levels move their timers down, the top
+	// first: they can land on the slot entered just below
+	while (top + 1 < TIMER_WHEEL_LEVELS && !(now & (((uint64_t)1 << LEVEL_SHIFT(top + 1)) - 1)))
+	{
+		top++;
+	}
+
+	for (uint8_t level = top; level > 0; level--)
+	{
+		uint8_t	 slot = (now >> LEVEL_SHIFT(level)) & SLOT_MASK;
+		uint32_t id	  = wheel->slots[level][slot];
+
+		wheel->slots[level][slot] = TIMER_WHEEL_NONE;
+		wheel->occupied[level] &= ~((uint64_t)1 << slot);
+
+		while (id != TIMER_WHEEL_NONE)
+		{
+			uint32_t next = wheel->timers[id].next;
+			link_timer(wheel, id);
+			id = next;
+		}
+	}
+
+	// one at a time: the callback may cancel the others
+	uint8_t slot = now & SLOT_MASK;
+
+	while (wheel->slots[0][slot] != TIMER_WHEEL_NONE)
+	{
+		uint32_t id		 = wheel->slots[0][slot];
+		uint32_t payload = wheel->timers[id].payload;
+
+		unlink_timer(wheel, id);
+		free_timer(wheel, id);
+		expire(payload);
+	}
+}
+
+// on the lowest level whose span covers the deadline
+static void link_timer(timer_wheel_t *wheel, uint32_t id)
+{
+	timer_wheel_timer_t *timer = &wheel->timers[id];
+	uint64_t			 delay = timer->deadline - wheel->now;
+	uint8_t				 level = 0;
+
+	delay = delay < SPAN ? delay : SPAN - 1;
+
+	while (delay >> LEVEL_SHIFT(level + 1))
+	{
+		level++;
+	}
+
+	timer->level = level;
+	timer->slot	 = ((wheel->now + delay) >> LEVEL_SHIFT(level)) & SLOT_MASK;
+	timer->prev	 = TIMER_WHEEL_NONE;
+	timer->next	 = wheel->slots[level][timer->slot];
+
+	if (timer->next != TIMER_WHEEL_NONE)
+	{
+		wheel->timers[timer->next].prev = id;
+	}
+
+	wheel->slots[level][timer->slot] = id;
+	wheel->occupied[level] |= (uint64_t)1 << timer->slot;
+}
+
+static void unlink_timer(timer_wheel_t *wheel, uint32_t id)
+{
+	timer_wheel_timer_t *timer = &wheel->timers[id];
+
+	if (timer->prev != TIMER_WHEEL_NONE)
+	{
+		wheel->timers[timer->prev].next = timer->next;
+	}
+	else if ((wheel->slots[timer->level][timer->slot] = timer->next) == TIMER_WHEEL_NONE)
+	{
+		wheel->occupied[timer->level] &= ~((uint64_t)1 << timer->slot);
+	}
+
+	if (timer->next != TIMER_WHEEL_NONE)
+	{
+		wheel->timers[timer->next].prev = timer->prev;
+	}
+}
+
+static void free_timer(timer_wheel_t *wheel, uint32_t id)
+{
+	wheel->timers[id].level = TIMER_WHEEL_LEVELS;
+	wheel->timers[id].next	= wheel->free;
+	wheel->free				= id;
+	wheel->length--;
+}
+
+// new ids go on the free list, lowest first
+static void grow(timer_wheel_t *wheel, uint32_t capacity)
+{
+	timer_wheel_timer_t *temp = mem_realloc(wheel->timers, sizeof(timer_wheel_timer_t) * capacity);
+
+	ASSERT(temp);
+
+	for (uint32_t id = capacity; id-- > wheel->capacity;)
+	{
+		temp[id].level = TIMER_WHEEL_LEVELS;
+		temp[id].next  = wheel->free;
+		wheel->free	   = id;
+	}
+
+	wheel->timers	= temp;
+	wheel->capacity = capacity;
+}
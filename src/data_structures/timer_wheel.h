@@ -0,0 +1,55 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include "../common.h"
+#include "../defs.h"
+
+// Hierarchical timer wheel: timers expire on an integer tick. Level l
+// has TIMER_WHEEL_SLOTS slots of TIMER_WHEEL_SLOTS^l ticks each. A timer
+// is filed on the lowest level whose span covers its deadline and moves
+// down a level when the clock enters its slot. A tick costs O(levels)
+// plus O(1) per timer expiring or moving down, however many timers are
+// pending. Per level occupancy bits give the next deadline in O(levels)
+// and let advance skip the ticks where nothing happens.
+// Timers are ids into a pool, carrying a payload for the caller (say,
+// the entity they belong to). Ids are reused once a timer expires or is
+// cancelled: cancel only pending timers.
+
+#define TIMER_WHEEL_SLOT_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_SLOT_BITS) // per level, a bit each on 'occupied'
+#define TIMER_WHEEL_LEVELS 4						  // 2^24 ticks ahead, later deadlines wait at the top
+#define TIMER_WHEEL_NONE UINT32_MAX
+#define TIMER_WHEEL_NEVER UINT64_MAX
+
+typedef struct
+{
+	uint64_t deadline; // tick
+	uint32_t payload;
+	uint32_t prev;	// slot list, TIMER_WHEEL_NONE at the ends
+	uint32_t next;	// slot list, or free list
+	uint8_t	 level; // TIMER_WHEEL_LEVELS while free
+	uint8_t	 slot;
+} timer_wheel_timer_t;
+
+typedef struct
+{
+	timer_wheel_timer_t *timers; // by id
+	uint32_t			 capacity;
+	uint32_t			 length;					   // pending timers
+	uint32_t			 free;						   // first free id
+	uint64_t			 now;						   // current tick
+	uint64_t			 occupied[TIMER_WHEEL_LEVELS]; // bit per non-empty slot
+	uint32_t			 slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+} timer_wheel_t;
+
+typedef void (*timer_wheel_expire_t)(uint32_t payload);
+
+timer_wheel_t timer_wheel_new(uint32_t capacity);
+void		  timer_wheel_dispose(timer_wheel_t *wheel);
+uint32_t	  timer_wheel_add(timer_wheel_t *wheel, uint64_t delay, uint32_t payload);
+void		  timer_wheel_cancel(timer_wheel_t *wheel, uint32_t id);
+void		  timer_wheel_clear(timer_wheel_t *wheel);
+uint64_t	  timer_wheel_next(const timer_wheel_t *wheel);
+void		  timer_wheel_advance(timer_wheel_t *wheel, uint64_t ticks, timer_wheel_expire_t expire);
+
+#endif
@@ -0,0 +1,29 @@
+#include "triple_buffer.h"
+
+void triple_buffer_init(triple_buffer_t *buffer)
+{
+	buffer->front  = 0;
+	buffer->shared = 1;
+	buffer->back   = 2;
+}
+
+// Swaps the filled back slot with the shared one, returns the new back slot.
+uint8_t triple_buffer_publish(triple_buffer_t *buffer)
+{
+	uint8_t prev = __atomic_exchange_n(&buffer->shared, buffer->back | TRIPLE_BUFFER_FRESH, __ATOMIC_ACQ_REL);
+	buffer->back = prev & (TRIPLE_BUFFER_FRESH - 1);
+
+	return buffer->back;
+}
+
+// Returns the slot of the latest published state.
+uint8_t triple_buffer_acquire(triple_buffer_t *buffer)
+{
+	if (__atomic_load_n(&buffer->shared, __ATOMIC_ACQUIRE) & TRIPLE_BUFFER_FRESH)
+	{
+		uint8_t prev  = __atomic_exchange_n(&buffer->shared, buffer->front, __ATOMIC_ACQ_REL);
+		buffer->front = prev & (TRIPLE_BUFFER_FRESH - 1);
+	}
+
+	return buffer->front;
+}
@@ -0,0 +1,23 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include "../defs.h"
+
+// Lock-free triple buffer index exchange between one writer and one reader.
+// The caller owns three slots: the writer fills 'back' and publishes it,
+// the reader takes the latest published slot as 'front'. Neither side
+// ever waits for the other, the reader just skips stale states.
+typedef struct
+{
+	uint8_t shared; // slot in the middle, TRIPLE_BUFFER_FRESH set when unread
+	uint8_t back;	// writer slot
+	uint8_t front;	// reader slot
+} triple_buffer_t;
+
+#define TRIPLE_BUFFER_FRESH 4
+
+void	triple_buffer_init(triple_buffer_t *buffer);
+uint8_t triple_buffer_publish(triple_buffer_t *buffer);
+uint8_t triple_buffer_acquire(triple_buffer_t *buffer);
+
+#endif
@@ -1,39 +1,177 @@
 #include "vector.h"
+#include "../mem.h"
+#include "../trace.h"
 
-void *vector_realloc(void *vec, size_t type_size, size_t chunk_size)
+static void *resize_block(const vector_allocator_t *allocator, void *block, size_t old_size, size_t new_size);
+
+void *vector_new(size_t type_size, uint32_t capacity, const vector_allocator_t *allocator, uint16_t growth)
 {
-	uint32_t  size	   = VECTOR_SIZE(vec);
-	uint32_t  length   = VECTOR_LENGTH(vec);
-	uint32_t  new_size = size == 0 ? chunk_size : size * 2;
-	uint32_t *header   = vec ? _VECTOR_HEADER(vec) : 0;
+	vector_header_t *header = resize_block(allocator, NULL, 0, VECTOR_HEADER_SIZE + capacity * type_size);
+
+	header->allocator = allocator;
+	header->capacity  = capacity;
+	header->length	  = 0;
+	header->growth	  = growth ? growth : VECTOR_GROWTH_DEFAULT;
+	header->is_inline = false;
 
-	uint32_t *result = (uint32_t *)realloc(header, (new_size * type_size) + (2 * sizeof(uint32_t)));
+	return (uint8_t *)header + VECTOR_HEADER_SIZE;
+}
+
+void *vector_new_inline(void *storage, size_t storage_size, size_t type_size)
+{
+	vector_header_t *header = storage;
 
-	ASSERT(result);
+	ASSERT(storage_size >= VECTOR_HEADER_SIZE);
 
-	result[0] = new_size;
-	result[1] = length;
+	header->allocator = NULL;
+	header->capacity  = (storage_size - VECTOR_HEADER_SIZE) / type_size;
+	header->length	  = 0;
+	header->growth	  = VECTOR_GROWTH_DEFAULT;
+	header->is_inline = true;
 
-	return (result + 2);
+	return (uint8_t *)header + VECTOR_HEADER_SIZE;
+}
+
+// exactly 'capacity' elements, never shrinks
+void *vector_reserve(void *vec, size_t type_size, uint32_t capacity)
+{
+	if (!vec)
+	{
+		TRACE3(vector_reserve, type_size, 0, capacity);
+		return vector_new(type_size, capacity, NULL, VECTOR_GROWTH_DEFAULT);
+	}
+
+	vector_header_t *header = _VECTOR_HEADER(vec);
+
+	if (capacity <= header->capacity)
+	{
+		return vec;
+	}
+
+	size_t old_size = VECTOR_HEADER_SIZE + header->capacity * type_size;
+	size_t new_size = VECTOR_HEADER_SIZE + capacity * type_size;
+
+	TRACE3(vector_reserve, type_size, header->capacity, capacity);
+
+	if (header->is_inline)
+	{
+		// spill to the heap, the inline storage is left unused
+		vector_header_t *block = resize_block(header->allocator, NULL, 0, new_size);
+		memcpy(block, header, VECTOR_HEADER_SIZE + header->length * type_size);
+		block->is_inline = false;
+		header			 = block;
+	}
+	else
+	{
+		header = resize_block(header->allocator, header, old_size, new_size);
+	}
+
+	header->capacity = capacity;
+
+	return (uint8_t *)header + VECTOR_HEADER_SIZE;
+}
+
+// room for at least 'min_capacity' elements, following the growth policy
+void *vector_grow(void *vec, size_t type_size, uint32_t min_capacity)
+{
+	uint32_t capacity = VECTOR_SIZE(vec);
+	uint64_t grown	  = vec ? (uint64_t)capacity * _VECTOR_HEADER(vec)->growth / 100 : 0;
+
+	grown = grown > capacity ? grown : capacity + 1;
+	grown = grown > VECTOR_MIN_CAPACITY ? grown : VECTOR_MIN_CAPACITY;
+	grown = grown > min_capacity ? grown : min_capacity;
+
+	ASSERT(grown <= UINT32_MAX);
+
+	return vector_reserve(vec, type_size, grown);
+}
+
+// gives the unused capacity back, an empty vector is freed (NULL)
+void *vector_shrink(void *vec, size_t type_size)
+{
+	if (!vec || _VECTOR_HEADER(vec)->is_inline)
+	{
+		return vec;
+	}
+
+	vector_header_t *header = _VECTOR_HEADER(vec);
+
+	if (!header->length)
+	{
+		vector_dispose(vec, type_size);
+		return NULL;
+	}
+
+	if (header->length < header->capacity)
+	{
+		size_t old_size = VECTOR_HEADER_SIZE + header->capacity * type_size;
+		size_t new_size = VECTOR_HEADER_SIZE + header->length * type_size;
+
+		header			 = resize_block(header->allocator, header, old_size, new_size);
+		header->capacity = header->length;
+	}
+
+	return (uint8_t *)header + VECTOR_HEADER_SIZE;
 }
 
 void vector_remove(void *vec, size_t type_size, uint32_t index)
 {
-	uint32_t  size	 = VECTOR_SIZE(vec);
-	uint32_t  length = VECTOR_LENGTH(vec);
-	uint32_t *header = vec ? _VECTOR_HEADER(vec) : 0;
+	vector_header_t *header = _VECTOR_HEADER(vec);
 
-	if (size == 0 || length == 0)
+	if (index >= header->length)
 	{
 		return;
 	}
 
-	if (length > 1 && index < (length - 1))
+	uint8_t *item = (uint8_t *)vec + index * type_size;
+	memmove(item, item + type_size, (header->length - index - 1) * type_size);
+	header->length--;
+}
+
+void vector_swap_remove(void *vec, size_t type_size, uint32_t index)
+{
+	vector_header_t *header = _VECTOR_HEADER(vec);
+
+	if (index >= header->length)
+	{
+		return;
+	}
+
+	if (index < header->length - 1)
+	{
+		memcpy((uint8_t *)vec + index * type_size, (uint8_t *)vec + (header->length - 1) * type_size, type_size);
+	}
+
+	header->length--;
+}
+
+void vector_dispose(void *vec, size_t type_size)
+{
+	vector_header_t *header = _VECTOR_HEADER(vec);
+
+	if (!header->is_inline)
 	{
-		size_t offset	   = (index * type_size);
-		size_t offset_last = ((length - 1) * type_size);
-		memmove(vec + offset, vec + offset_last, type_size);
+		resize_block(header->allocator, header, VECTOR_HEADER_SIZE + header->capacity * type_size, 0);
 	}
+}
 
-	header[1]--;
-}
\ No newline at end of file
+static void *resize_block(const vector_allocator_t *allocator, void *block, size_t old_size, size_t new_size)
+{
+	if (allocator)
+	{
+		block = allocator->resize(allocator->context, block, old_size, new_size);
+	}
+	else if (new_size)
+	{
+		block = mem_realloc(block, new_size);
+	}
+	else
+	{
+		mem_free(block);
+		return NULL;
+	}
+
+	ASSERT(block || !new_size);
+
+	return block;
+}
@@ -4,21 +4,75 @@
 #include "../common.h"
 #include "../defs.h"
 
-#define VECTOR_CHUNK_SIZE 2048
+// Typed dynamic array: 'vec' is a plain 'type *' to the elements, with
+// a header stored right before them. A NULL vector is a valid empty
+// vector, the first push allocates VECTOR_MIN_CAPACITY elements.
+//
+//   uint32_t *ids = NULL;
+//   VECTOR_RESERVE(ids, 64); // optional, no reallocation up to 64
+//   VECTOR_PUSH(ids, 7);
+//   VECTOR_DISPOSE(ids);
+//
+// Vectors grow by 'growth' percent of their capacity when full. Every
+// heap operation goes through an optional allocator, so a vector can
+// live in an arena. Small vectors can start in caller provided storage
+// (VECTOR_STORAGE) and only move to the heap when they outgrow it; the
+// storage must outlive the vector and not move while it's used.
 
-void *vector_realloc(void *vec, size_t type_size, size_t chunk_size);
+#define VECTOR_MIN_CAPACITY 8	  // elements of the first heap allocation
+#define VECTOR_GROWTH_DEFAULT 200 // percent, doubles the capacity
+
+// realloc-like hook: 'ptr' NULL allocates, 'new_size' 0 frees. Blocks
+// must be aligned as malloc's.
+typedef struct vector_allocator_t
+{
+	void *(*resize)(void *context, void *ptr, size_t old_size, size_t new_size);
+	void *context;
+} vector_allocator_t;
+
+typedef struct vector_header_t
+{
+	const vector_allocator_t *allocator; // NULL: C heap
+	uint32_t				  capacity;
+	uint32_t				  length;
+	uint16_t				  growth;	 // percent of the capacity when full
+	bool					  is_inline; // elements are in VECTOR_STORAGE
+} vector_header_t;
+
+// elements start this far after the header, aligned for any type
+#define VECTOR_HEADER_SIZE ((sizeof(vector_header_t) + 15) & ~(size_t)15)
+
+// declares inline storage for 'capacity' elements of 'type'
+#define VECTOR_STORAGE(type, capacity)                                    \
+	union                                                                 \
+	{                                                                     \
+		long double align;                                                \
+		uint8_t		bytes[VECTOR_HEADER_SIZE + sizeof(type) * (capacity)]; \
+	}
+
+void *vector_new(size_t type_size, uint32_t capacity, const vector_allocator_t *allocator, uint16_t growth);
+void *vector_new_inline(void *storage, size_t storage_size, size_t type_size);
+void *vector_reserve(void *vec, size_t type_size, uint32_t capacity);
+void *vector_grow(void *vec, size_t type_size, uint32_t min_capacity);
+void *vector_shrink(void *vec, size_t type_size);
 void  vector_remove(void *vec, size_t type_size, uint32_t index);
+void  vector_swap_remove(void *vec, size_t type_size, uint32_t index);
+void  vector_dispose(void *vec, size_t type_size);
 
-#define VECTOR_PUSH(vec, val) (_VECTOR_CHECK(vec) ? ((vec)[_VECTOR_HEADER(vec)[1]++] = (val)), 1 : 0)
-#define VECTOR_REMOVE(vec, index) ((vec) ? vector_remove(vec, sizeof(*vec), index), 1 : 0)
-#define VECTOR_SIZE(vec) ((vec) ? _VECTOR_HEADER(vec)[0] : 0)
-#define VECTOR_LENGTH(vec) ((vec) ? _VECTOR_HEADER(vec)[1] : 0)
+#define VECTOR_WITH_CAPACITY(type, capacity, allocator, growth) ((type *)vector_new(sizeof(type), capacity, allocator, growth))
+#define VECTOR_INLINE(type, storage) ((type *)vector_new_inline(&(storage), sizeof(storage), sizeof(type)))
+#define VECTOR_RESERVE(vec, capacity) (*((void **)&(vec)) = vector_reserve(vec, sizeof(*(vec)), capacity))
+#define VECTOR_SHRINK(vec) (*((void **)&(vec)) = vector_shrink(vec, sizeof(*(vec))))
+#define VECTOR_PUSH(vec, val) (_VECTOR_GROW(vec, VECTOR_LENGTH(vec) + 1), (vec)[_VECTOR_HEADER(vec)->length++] = (val))
+#define VECTOR_REMOVE(vec, index) ((vec) ? vector_remove(vec, sizeof(*(vec)), index), 1 : 0)			 // keeps the order, O(n)
+#define VECTOR_SWAP_REMOVE(vec, index) ((vec) ? vector_swap_remove(vec, sizeof(*(vec)), index), 1 : 0) // moves the last element, O(1)
+#define VECTOR_SIZE(vec) ((vec) ? _VECTOR_HEADER(vec)->capacity : 0)
+#define VECTOR_LENGTH(vec) ((vec) ? _VECTOR_HEADER(vec)->length : 0)
 #define VECTOR_CHECK(vec, index) (((int32_t)index < 0 || index >= VECTOR_LENGTH(vec)) ? false : true)
-#define VECTOR_CLEAR(vec) ((vec) ? _VECTOR_HEADER(vec)[1] = 0, 1 : 0)
-#define VECTOR_DISPOSE(vec) (_VECTOR_DISPOSE(vec) ? (vec) = 0, 1 : 0)
+#define VECTOR_CLEAR(vec) ((vec) ? _VECTOR_HEADER(vec)->length = 0, 1 : 0)
+#define VECTOR_DISPOSE(vec) ((vec) ? vector_dispose(vec, sizeof(*(vec))), (vec) = 0, 1 : 0)
 
-#define _VECTOR_HEADER(_vec) ((uint32_t *)(_vec)-2)
-#define _VECTOR_CHECK(_vec) (_vec == 0 || VECTOR_LENGTH(_vec) >= VECTOR_SIZE(_vec) ? (*((void **)&(_vec)) = vector_realloc(_vec, sizeof(*_vec), VECTOR_CHUNK_SIZE)), 1 : 1)
-#define _VECTOR_DISPOSE(vec) ((vec) ? free(_VECTOR_HEADER(vec)), 1 : 0)
+#define _VECTOR_HEADER(_vec) ((vector_header_t *)((uint8_t *)(_vec)-VECTOR_HEADER_SIZE))
+#define _VECTOR_GROW(_vec, _n) (VECTOR_SIZE(_vec) < (_n) ? (*((void **)&(_vec)) = vector_grow(_vec, sizeof(*(_vec)), _n)), 1 : 1)
 
 #endif
@@ -24,6 +24,9 @@ typedef double float64_t;
 
 #define FILE_SCORE "score.txt"
 
+// 9600 baud, 10 bits per byte on the wire, 20 frames per second
+#define LOW_BANDWIDTH_FRAME_BYTES 48
+
 typedef enum color_pair_t
 {
 	COLOR_PAIR_BLUE	   = 1,
@@ -39,6 +42,30 @@ typedef struct vec2_t
 	int16_t y;
 } vec2_t;
 
+// command line options
+typedef struct options_t
+{
+	const char *serve_path;		 // host a game server on this unix socket
+	const char *spectate_path;	 // watch the game hosted on this unix socket
+	const char *record_path;	 // record the session as an asciicast v2 file
+	const char *bot_path;		 // shared object of the bot playing the game
+	uint32_t	bot_budget_us;	 // decision time budget of the bot
+	uint32_t	bot_strikes;	 // late decisions before the bot is disqualified, 0: never
+	bool		autopilot;		 // the snake follows a Hamiltonian cycle, soak mode
+	bool		low_bandwidth;	 // plain ASCII, no colors, for slow serial consoles
+	bool		narrow;			 // one terminal column per board cell
+	uint32_t	max_frame_bytes; // terminal output budget per frame, 0: unlimited
+	uint32_t	train_frames;	 // scripted headless session length
+	uint32_t	seed;			 // random seed, 0 seeds from the clock
+	bool		headless;		 // no terminal attached
+	bool		alloc_guard;	 // abort on allocations of the warmed up game loop
+	uint32_t	batch_games;	 // games of the batch engine benchmark, 0: play
+	bool		startup_report;	 // print the startup phases on exit
+	uint32_t	arena_snakes;	 // snakes of the arena benchmark, 0: play
+	uint32_t	threads;		 // arena threads, 0: one per CPU
+	bool		world;			 // open world endurance session, headless
+} options_t;
+
 typedef struct score_t
 {
 	uint32_t current;
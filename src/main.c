@@ -1,19 +1,42 @@
-#define _POSIX_C_SOURCE 199309L
+#define _POSIX_C_SOURCE 200809L
+#include "arena.h"
+#include "autopilot.h"
+#include "batch.h"
+#include "bot.h"
 #include "common.h"
+#include "compositor.h"
 #include "defs.h"
+#include "mem.h"
+#include "net/server.h"
+#include "recorder.h"
+#include "rules.h"
 #include "screens/screens.h"
+#include "startup.h"
+#include "stats.h"
+#include "terminal.h"
+#include "trace.h"
+#include "world.h"
 
-#define TERMINAL_COLS 100
-#define TERMINAL_ROWS 50
+#define HEADLESS_COLS 100
+#define HEADLESS_ROWS 50
+#define FALLBACK_COLS 80
+#define FALLBACK_ROWS 24
 
 #define FILE_SPLASH "assets/splash.txt"
 #define FILE_GAME_OVER "assets/game_over.txt"
 
+#ifdef _WIN32
+#define FILE_NULL_DEVICE "NUL"
+#else
+#define FILE_NULL_DEVICE "/dev/null"
+#endif
+
 typedef enum screen_t
 {
 	SCREEN_INIT	  = 1,
 	SCREEN_GAME	  = 2,
-	SCREEN_RESULT = 3
+	SCREEN_RESULT	= 3,
+	SCREEN_SPECTATE = 4
 } screen_t;
 
 typedef void (*screen_action_t)(void);
@@ -26,6 +49,7 @@ float32_t g_delta_time		= 0;
 char	 *g_asset_splash	= NULL;
 char	 *g_asset_game_over = NULL;
 score_t	  g_score			= { .current = 0 };
+options_t g_options			= { .bot_budget_us = 1000 };
 
 static const float32_t c_target_frame_time = 1.0 / 20.0; // 20 FPS
 
@@ -38,7 +62,10 @@ static screen_action_t		 screen_action_window_resized = NULL;
 static screen_t				 current_screen				  = 0;
 
 static float32_t last_update_time = 0.0;
+static uint32_t	 screen_frames	  = 0;	  // since the current screen started
+static bool		 deferred_done	  = false; // see run_deferred
 
+static void		 parse_options(int argc, char *argv[]);
 static void		 init(void);
 static void		 dispose(void);
 static void		 load_assets(void);
@@ -46,69 +73,285 @@ static void		 load_asset(const char *file, char **dest);
 static void		 load_score(void);
 static void		 update_state(void);
 static void		 loop(void);
+static void		 train(void);
+static void		 run_frame(float32_t frame_time);
+static void		 run_deferred(void);
+static int		 train_key(uint32_t frame);
 static float32_t get_current_time(void);
 
 int main(int argc, char *argv[])
 {
-	(void)argc;
-	(void)argv;
+	startup_begin();
+	parse_options(argc, argv);
+	startup_mark("options");
+
+	// no screens and no terminal, the games are the batch engine's
+	if (g_options.batch_games)
+	{
+		batch_bench(g_options.batch_games, g_options.train_frames ? g_options.train_frames : BATCH_DEFAULT_TICKS, g_options.seed);
+		return 0;
+	}
+
+	// same for the arena's snakes
+	if (g_options.arena_snakes)
+	{
+		arena_bench(g_options.arena_snakes, g_options.threads, g_options.train_frames ? g_options.train_frames : ARENA_DEFAULT_TICKS,
+					g_options.seed);
+		return 0;
+	}
+
+	// and the open world's
+	if (g_options.world)
+	{
+		world_session(g_options.train_frames ? g_options.train_frames : WORLD_DEFAULT_TICKS, g_options.seed);
+		return 0;
+	}
 
 	init();
-	loop();
+
+	if (g_options.train_frames)
+	{
+		train();
+	}
+	else
+	{
+		loop();
+	}
+
 	dispose();
 
+	if (g_options.startup_report)
+	{
+		startup_report(stderr);
+	}
+
 	return 0;
 }
 
+static void parse_options(int argc, char *argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--serve") && i + 1 < argc)
+		{
+			g_options.serve_path = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--spectate") && i + 1 < argc)
+		{
+			g_options.spectate_path = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--record") && i + 1 < argc)
+		{
+			g_options.record_path = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--train") && i + 1 < argc)
+		{
+			g_options.train_frames = strtoul(argv[++i], NULL, 10);
+			g_options.headless	   = true;
+		}
+		else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+		{
+			g_options.seed = strtoul(argv[++i], NULL, 10);
+		}
+		else if (!strcmp(argv[i], "--bot") && i + 1 < argc)
+		{
+			g_options.bot_path = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--bot-budget-us") && i + 1 < argc)
+		{
+			g_options.bot_budget_us = strtoul(argv[++i], NULL, 10);
+		}
+		else if (!strcmp(argv[i], "--bot-strikes") && i + 1 < argc)
+		{
+			g_options.bot_strikes = strtoul(argv[++i], NULL, 10);
+		}
+		else if (!strcmp(argv[i], "--autopilot"))
+		{
+			g_options.autopilot = true;
+		}
+		else if (!strcmp(argv[i], "--low-bandwidth"))
+		{
+			g_options.low_bandwidth = true;
+		}
+		else if (!strcmp(argv[i], "--narrow"))
+		{
+			g_options.narrow = true;
+		}
+		else if (!strcmp(argv[i], "--max-frame-bytes") && i + 1 < argc)
+		{
+			g_options.max_frame_bytes = strtoul(argv[++i], NULL, 10);
+		}
+		else if (!strcmp(argv[i], "--alloc-guard"))
+		{
+			g_options.alloc_guard = true;
+		}
+		else if (!strcmp(argv[i], "--startup-report"))
+		{
+			g_options.startup_report = true;
+		}
+		else if (!strcmp(argv[i], "--batch") && i + 1 < argc)
+		{
+			g_options.batch_games = strtoul(argv[++i], NULL, 10);
+		}
+		else if (!strcmp(argv[i], "--arena") && i + 1 < argc)
+		{
+			g_options.arena_snakes = strtoul(argv[++i], NULL, 10);
+		}
+		else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+		{
+			g_options.threads = strtoul(argv[++i], NULL, 10);
+		}
+		else if (!strcmp(argv[i], "--world"))
+		{
+			g_options.world = true;
+		}
+		else
+		{
+			fprintf(stderr,
+					"usage: %s [options]\n"
+					"  --serve SOCKET     host the game on a unix socket\n"
+					"  --spectate SOCKET  watch a game hosted on a unix socket\n"
+					"  --record FILE      record the session as asciicast v2\n"
+					"  --train FRAMES     play FRAMES scripted frames headless, no terminal needed\n"
+					"  --seed N           fixed random seed\n"
+					"  --bot FILE         let the bot in this shared object play\n"
+					"  --bot-budget-us N  bot decision time budget (default 1000)\n"
+					"  --bot-strikes N    disqualify the bot after N late decisions\n"
+					"  --autopilot        play on a Hamiltonian cycle, never losing (soak mode)\n"
+					"  --low-bandwidth    plain ASCII without colors, for slow serial consoles\n"
+					"  --narrow           one terminal column per board cell\n"
+					"  --max-frame-bytes N  terminal output budget per frame, cosmetic updates\n"
+					"                     are dropped first (low bandwidth default %d)\n"
+					"  --alloc-guard      abort with a backtrace if the game allocates once warmed up\n"
+					"  --batch GAMES      step GAMES headless games in lockstep for --train ticks, report game-ticks/s\n"
+					"  --arena SNAKES     run SNAKES AI snakes on one board for --train ticks, report snake-moves/s\n"
+					"  --threads N        arena threads (default one per CPU)\n"
+					"  --world            one AI snake on an unbounded board for --train ticks, report memory use\n"
+					"  --startup-report   print the startup phases and their durations on exit\n",
+					argv[0], LOW_BANDWIDTH_FRAME_BYTES);
+			exit(1);
+		}
+	}
+
+	if (g_options.low_bandwidth && !g_options.max_frame_bytes)
+	{
+		g_options.max_frame_bytes = LOW_BANDWIDTH_FRAME_BYTES;
+	}
+}
+
 static void init(void)
 {
+	if (g_options.serve_path && !server_open(g_options.serve_path))
+	{
+		fprintf(stderr, "unable to open game server on %s\n", g_options.serve_path);
+		exit(1);
+	}
+
+	uint16_t rows = FALLBACK_ROWS, cols = FALLBACK_COLS;
+	terminal_size(&rows, &cols);
+
+	if (g_options.record_path && !recorder_open(g_options.record_path, cols, rows))
+	{
+		fprintf(stderr, "unable to record on %s\n", g_options.record_path);
+		exit(1);
+	}
+
+	if (g_options.bot_path && !bot_load(g_options.bot_path, g_options.bot_budget_us * 1000ULL, g_options.bot_strikes, g_options.seed))
+	{
+		fprintf(stderr, "unable to load bot %s\n", g_options.bot_path);
+		exit(1);
+	}
+
+	if (g_options.autopilot)
+	{
+		autopilot_open();
+	}
+
+	// best effort, the game runs the same without its stats page
+	stats_open();
+	startup_mark("services");
+
+	srand(g_options.seed ? g_options.seed : time(NULL));
 	load_assets();
-	load_score();
-	initscr();
+	startup_mark("splash asset");
+
+	if (g_options.headless)
+	{
+		// render into a terminal nobody looks at
+		FILE *null_output = fopen(FILE_NULL_DEVICE, "w");
+		FILE *null_input  = fopen(FILE_NULL_DEVICE, "r");
+		ASSERT(null_output && null_input);
+		ASSERT(newterm(getenv("TERM") ? NULL : "xterm", null_output, null_input));
+		resize_term(HEADLESS_ROWS, HEADLESS_COLS);
+	}
+	else
+	{
+		initscr();
+	}
+
+	startup_mark("terminal");
+
 	cbreak();
 	noecho();
 	curs_set(0);
 	nodelay(stdscr, TRUE);
 	keypad(stdscr, TRUE);
 	// timeout(5);
-	resize_term(TERMINAL_ROWS, TERMINAL_COLS);
-	start_color();
+	startup_mark("terminal setup");
 
-	init_color(COLOR_RED, 1000, 0, 0);
-	init_color(COLOR_GREEN, 0, 700, 0);
-	init_color(COLOR_BLUE, 0, 0, 700);
+	// without start_color curses ignores the color pairs the screens set,
+	// so no color escape ever reaches the terminal
+	if (!g_options.low_bandwidth)
+	{
+		start_color();
 
-	init_pair(COLOR_PAIR_BLUE, COLOR_BLUE, COLOR_BLACK);
-	init_pair(COLOR_PAIR_BLUE_BK, COLOR_WHITE, COLOR_BLUE);
-	init_pair(COLOR_PAIR_RED, COLOR_RED, COLOR_BLACK);
-	init_pair(COLOR_PAIR_RED_BK, COLOR_WHITE, COLOR_RED);
-	init_pair(COLOR_PAIR_GREEN, COLOR_GREEN, COLOR_BLACK);
+		init_color(COLOR_RED, 1000, 0, 0);
+		init_color(COLOR_GREEN, 0, 700, 0);
+		init_color(COLOR_BLUE, 0, 0, 700);
+
+		init_pair(COLOR_PAIR_BLUE, COLOR_BLUE, COLOR_BLACK);
+		init_pair(COLOR_PAIR_BLUE_BK, COLOR_WHITE, COLOR_BLUE);
+		init_pair(COLOR_PAIR_RED, COLOR_RED, COLOR_BLACK);
+		init_pair(COLOR_PAIR_RED_BK, COLOR_WHITE, COLOR_RED);
+		init_pair(COLOR_PAIR_GREEN, COLOR_GREEN, COLOR_BLACK);
+	}
 
-	refresh();
+	compositor_add(stdscr, 0);
+	compositor_set_byte_budget(g_options.max_frame_bytes);
+	startup_mark("colors");
 }
 
 static void dispose(void)
 {
 	if (g_asset_splash)
 	{
-		free(g_asset_splash);
+		mem_free(g_asset_splash);
 	}
 
 	if (g_asset_game_over)
 	{
-		free(g_asset_game_over);
+		mem_free(g_asset_game_over);
 	}
 
+	screen_game_release();
+	screen_result_release();
+	server_close();
 	use_default_colors();
 	endwin();
+	recorder_close();
+	stats_close();
+	bot_unload();
+	autopilot_close();
 }
 
 static void loop(void)
 {
+	uint64_t frame	 = 0;
 	last_update_time = get_current_time();
 
 	while (g_running)
 	{
+		TRACE1(frame_start, frame);
 		g_key = getch();
 
 		if (g_key == KEY_F(1) || g_key == CH_ESC)
@@ -117,11 +360,10 @@ static void loop(void)
 		}
 		else if (g_key == KEY_RESIZE)
 		{
-			resize_term(TERMINAL_ROWS, TERMINAL_COLS);
 			noecho();
 			cbreak();
 			curs_set(0);
-			refresh();
+			compositor_damage(stdscr);
 
 			if (screen_action_window_resized)
 			{
@@ -141,20 +383,131 @@ static void loop(void)
 
 		g_delta_time = real_delta_time;
 
-		update_state();
-		screen_action_update();
-		screen_action_render();
+		run_frame(real_delta_time);
+		TRACE1(frame_end, frame++);
+	}
+
+	if (screen_action_dispose)
+	{
+		screen_action_dispose();
+	}
+}
+
+// Plays a deterministic session as fast as possible: fixed frame time,
+// scripted input and no terminal. It's the training workload of the
+// profile-guided build and runs the same code paths as a real session.
+static void train(void)
+{
+	float32_t start = get_current_time();
+
+	for (uint32_t frame = 0; frame < g_options.train_frames; frame++)
+	{
+		TRACE1(frame_start, frame);
+		g_key		 = train_key(frame);
+		g_delta_time = c_target_frame_time;
+
+		run_frame(g_delta_time);
+		TRACE1(frame_end, frame);
 	}
 
 	if (screen_action_dispose)
 	{
 		screen_action_dispose();
 	}
+
+	fprintf(stderr, "trained %u frames in %.3fs\n", g_options.train_frames, get_current_time() - start);
+
+	static const char *scope_names[] = { [SCREEN_INIT] = "init", [SCREEN_GAME] = "game", [SCREEN_RESULT] = "result", [SCREEN_SPECTATE] = "spectate" };
+
+	for (uint8_t scope = SCREEN_INIT; scope <= SCREEN_SPECTATE; scope++)
+	{
+		mem_counters_t counters = mem_scope_total(scope);
+		fprintf(stderr, "  %-8s %8llu allocations %10llu bytes\n", scope_names[scope], (unsigned long long)counters.allocations,
+				(unsigned long long)counters.bytes);
+	}
+}
+
+// one frame of the current screen, the same for the game loop and train
+static void run_frame(float32_t frame_time)
+{
+	mem_frame();
+	update_state();
+	screen_frames++;
+
+	// once warmed up, the game screen must not allocate
+	mem_guard(g_options.alloc_guard && current_screen == SCREEN_GAME && screen_frames > MEM_GUARD_WARMUP_FRAMES);
+	screen_action_update();
+	screen_action_render();
+	mem_guard(false);
+
+	compositor_present();
+	stats_frame(current_screen, frame_time);
+
+	// the game screen polls the server from its simulation
+	if (current_screen != SCREEN_GAME)
+	{
+		server_poll();
+	}
+
+	if (!deferred_done)
+	{
+		startup_mark("first frame");
+		run_deferred();
+	}
+}
+
+// Startup work the first frame does without, done once it's on screen:
+// the splash screen waits for a key anyway. Nothing leaves the first
+// screen before it's done, update_state makes sure of it.
+static void run_deferred(void)
+{
+	deferred_done = true;
+
+	load_asset(FILE_GAME_OVER, &g_asset_game_over);
+	startup_mark("game over asset");
+	load_score();
+	startup_mark("score");
+
+	if (!g_options.spectate_path)
+	{
+		screen_game_prepare();
+		startup_mark("game buffers");
+	}
+}
+
+static int train_key(uint32_t frame)
+{
+	static const int keys[]	  = { KEY_UP, KEY_LEFT, KEY_DOWN, KEY_RIGHT };
+	static uint32_t	 state	  = 1;
+	static uint32_t	 next_key = 0;
+
+	if (frame < next_key)
+	{
+		return frame % 40 ? ERR : CH_ENTER; // ENTER moves on from the init and result screens
+	}
+
+	// independent from the game rand() sequence
+	random_next(&state);
+	next_key = frame + 10 + state % 30;
+
+	return keys[state % 4];
 }
 
 static void update_state(void)
 {
-	if (!current_screen)
+	screen_t previous_screen = current_screen;
+
+	if (!current_screen && g_options.spectate_path)
+	{
+		screen_action_init			 = &screen_spectate_init;
+		screen_action_dispose		 = &screen_spectate_dispose;
+		screen_action_update		 = &screen_spectate_update;
+		screen_action_render		 = &screen_spectate_render;
+		screen_is_completed			 = &screen_spectate_is_completed;
+		screen_action_window_resized = &screen_spectate_window_resized;
+		current_screen				 = SCREEN_SPECTATE;
+	}
+	else if (!current_screen)
 	{
 		screen_action_init			 = &screen_init_init;
 		screen_action_dispose		 = &screen_init_dispose;
@@ -162,11 +515,15 @@ static void update_state(void)
 		screen_action_render		 = &screen_init_render;
 		screen_is_completed			 = &screen_init_is_completed;
 		screen_action_window_resized = &screen_init_window_resized;
-		screen_action_init();
-		current_screen = SCREEN_INIT;
+		current_screen				 = SCREEN_INIT;
 	}
 	else if ((current_screen == SCREEN_INIT || current_screen == SCREEN_RESULT) && screen_is_completed())
 	{
+		if (!deferred_done)
+		{
+			run_deferred();
+		}
+
 		screen_action_dispose();
 		screen_action_init			 = &screen_game_init;
 		screen_action_dispose		 = &screen_game_dispose;
@@ -174,8 +531,7 @@ static void update_state(void)
 		screen_action_render		 = &screen_game_render;
 		screen_is_completed			 = &screen_game_is_completed;
 		screen_action_window_resized = &screen_game_window_resized;
-		screen_action_init();
-		current_screen = SCREEN_GAME;
+		current_screen				 = SCREEN_GAME;
 	}
 	else if (current_screen == SCREEN_GAME && screen_is_completed())
 	{
@@ -186,15 +542,28 @@ static void update_state(void)
 		screen_action_render		 = &screen_result_render;
 		screen_is_completed			 = &screen_result_is_completed;
 		screen_action_window_resized = NULL;
+		current_screen				 = SCREEN_RESULT;
+	}
+
+	// the new screen allocates in its own scope
+	if (current_screen != previous_screen)
+	{
+		TRACE2(screen, previous_screen, current_screen);
+		mem_scope(current_screen);
+		screen_frames = 0;
 		screen_action_init();
-		current_screen = SCREEN_RESULT;
+
+		if (!previous_screen)
+		{
+			startup_mark("first screen init");
+		}
 	}
 }
 
+// the splash only, the other assets wait for run_deferred
 static void load_assets(void)
 {
 	load_asset(FILE_SPLASH, &g_asset_splash);
-	load_asset(FILE_GAME_OVER, &g_asset_game_over);
 }
 
 static void load_asset(const char *file, char **dest)
@@ -205,7 +574,7 @@ static void load_asset(const char *file, char **dest)
 	fseek(f, 0, SEEK_END);
 	int32_t length = ftell(f) + 1;
 	fseek(f, 0, SEEK_SET);
-	*dest = calloc(length, sizeof(char));
+	*dest = mem_calloc(length, sizeof(char));
 	ASSERT(*dest);
 
 	fread(*dest, sizeof(char), length, f);
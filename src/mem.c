@@ -0,0 +1,129 @@
+#define _POSIX_C_SOURCE 200809L
+#include "mem.h"
+#include "common.h"
+
+#ifdef __linux__
+#include <execinfo.h>
+#include <unistd.h>
+#endif
+
+// Counters are updated with relaxed atomics: the simulation thread of
+// the game screen allocates too. The guard is per thread, each thread
+// arms it around its own steady-state work.
+
+#define MEM_BACKTRACE_DEPTH 32
+
+static mem_counters_t total;
+static mem_counters_t scopes[MEM_SCOPES];
+static mem_counters_t frame;
+static uint8_t		  current_scope = 0;
+static __thread bool  guard_armed	= false;
+
+static void track(const char *function, size_t size);
+static void guard_trip(const char *function, size_t size);
+
+void *mem_alloc(size_t size)
+{
+	track("mem_alloc", size);
+	return malloc(size);
+}
+
+void *mem_calloc(size_t count, size_t size)
+{
+	track("mem_calloc", count * size);
+	return calloc(count, size);
+}
+
+// a realloc to 0 bytes frees, like free() it isn't counted
+void *mem_realloc(void *ptr, size_t size)
+{
+	if (!size)
+	{
+		free(ptr);
+		return NULL;
+	}
+
+	track("mem_realloc", size);
+	return realloc(ptr, size);
+}
+
+void mem_free(void *ptr)
+{
+	free(ptr);
+}
+
+// starts a frame of the game loop
+void mem_frame(void)
+{
+	__atomic_store_n(&frame.allocations, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&frame.bytes, 0, __ATOMIC_RELAXED);
+}
+
+// the screen the next allocations are counted on
+void mem_scope(uint8_t scope)
+{
+	ASSERT(scope < MEM_SCOPES);
+	__atomic_store_n(&current_scope, scope, __ATOMIC_RELAXED);
+}
+
+// while armed, any allocation of this thread aborts with a backtrace
+void mem_guard(bool armed)
+{
+	guard_armed = armed;
+}
+
+mem_counters_t mem_total(void)
+{
+	return (mem_counters_t){ .allocations = __atomic_load_n(&total.allocations, __ATOMIC_RELAXED),
+							 .bytes		  = __atomic_load_n(&total.bytes, __ATOMIC_RELAXED) };
+}
+
+mem_counters_t mem_scope_total(uint8_t scope)
+{
+	ASSERT(scope < MEM_SCOPES);
+	return (mem_counters_t){ .allocations = __atomic_load_n(&scopes[scope].allocations, __ATOMIC_RELAXED),
+							 .bytes		  = __atomic_load_n(&scopes[scope].bytes, __ATOMIC_RELAXED) };
+}
+
+mem_counters_t mem_frame_total(void)
+{
+	return (mem_counters_t){ .allocations = __atomic_load_n(&frame.allocations, __ATOMIC_RELAXED),
+							 .bytes		  = __atomic_load_n(&frame.bytes, __ATOMIC_RELAXED) };
+}
+
+static void track(const char *function, size_t size)
+{
+	mem_counters_t *scope = &scopes[__atomic_load_n(&current_scope, __ATOMIC_RELAXED)];
+
+	if (guard_armed)
+	{
+		guard_trip(function, size);
+	}
+
+	__atomic_fetch_add(&total.allocations, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&total.bytes, size, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&scope->allocations, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&scope->bytes, size, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&frame.allocations, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&frame.bytes, size, __ATOMIC_RELAXED);
+}
+
+static void guard_trip(const char *function, size_t size)
+{
+	guard_armed = false;
+
+	// leave the terminal usable before printing
+	if (!isendwin())
+	{
+		endwin();
+	}
+
+	fprintf(stderr, "%s of %zu bytes in the steady-state game loop (--alloc-guard)\n", function, size);
+
+#ifdef __linux__
+	void *frames[MEM_BACKTRACE_DEPTH];
+	backtrace_symbols_fd(frames, backtrace(frames, MEM_BACKTRACE_DEPTH), STDERR_FILENO);
+#endif
+
+	abort();
+}
@@ -0,0 +1,32 @@
+#ifndef MEM_H
+#define MEM_H
+
+#include "defs.h"
+
+// Allocation tracking: all project code allocates through these wrappers
+// so the game can count its allocations per screen and per frame, and
+// prove that the game loop doesn't allocate once it's warmed up. Memory
+// allocated by curses or the C library itself isn't seen.
+
+#define MEM_SCOPES 8				  // main.c screen_t values
+#define MEM_GUARD_WARMUP_FRAMES 120 // frames of a screen before the guard arms
+
+typedef struct mem_counters_t
+{
+	uint64_t allocations; // malloc, calloc and realloc calls
+	uint64_t bytes;		  // bytes they asked for
+} mem_counters_t;
+
+void *mem_alloc(size_t size);
+void *mem_calloc(size_t count, size_t size);
+void *mem_realloc(void *ptr, size_t size);
+void  mem_free(void *ptr);
+
+void		   mem_frame(void);
+void		   mem_scope(uint8_t scope);
+void		   mem_guard(bool armed);
+mem_counters_t mem_total(void);
+mem_counters_t mem_scope_total(uint8_t scope);
+mem_counters_t mem_frame_total(void);
+
+#endif
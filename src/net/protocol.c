@@ -0,0 +1,65 @@
+#include "protocol.h"
+
+static void buffer_put(net_buffer_t *buffer, const void *val, uint32_t size)
+{
+	if (buffer->length + size > buffer->size)
+	{
+		buffer->overflow = true;
+		return;
+	}
+
+	memcpy(buffer->data + buffer->length, val, size);
+	buffer->length += size;
+}
+
+static void reader_get(net_reader_t *reader, void *dest, uint32_t size)
+{
+	if (reader->offset + size > reader->length)
+	{
+		reader->overflow = true;
+		memset(dest, 0, size);
+		return;
+	}
+
+	memcpy(dest, reader->data + reader->offset, size);
+	reader->offset += size;
+}
+
+void net_buffer_put_u8(net_buffer_t *buffer, uint8_t val)
+{
+	buffer_put(buffer, &val, sizeof(val));
+}
+
+void net_buffer_put_u16(net_buffer_t *buffer, uint16_t val)
+{
+	buffer_put(buffer, &val, sizeof(val));
+}
+
+void net_buffer_put_u32(net_buffer_t *buffer, uint32_t val)
+{
+	buffer_put(buffer, &val, sizeof(val));
+}
+
+uint8_t net_reader_get_u8(net_reader_t *reader)
+{
+	uint8_t val;
+	reader_get(reader, &val, sizeof(val));
+
+	return val;
+}
+
+uint16_t net_reader_get_u16(net_reader_t *reader)
+{
+	uint16_t val;
+	reader_get(reader, &val, sizeof(val));
+
+	return val;
+}
+
+uint32_t net_reader_get_u32(net_reader_t *reader)
+{
+	uint32_t val;
+	reader_get(reader, &val, sizeof(val));
+
+	return val;
+}
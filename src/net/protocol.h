@@ -0,0 +1,81 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include "../board.h"
+#include "../defs.h"
+#include "../rules.h"
+
+// Wire format shared by the game server and its clients.
+// Every frame is a fixed size header followed by 'length' payload bytes.
+// Integers travel in host byte order: both ends run on the same machine.
+//
+// A keyframe carries the whole game state so a client can (re)build its
+// mirror from scratch. A delta carries the ops that happened on one tick:
+//   NET_OP_HEAD_ADD    x:u16 y:u16         new head cell
+//   NET_OP_TAIL_REMOVE                     drop the last snake segment
+//   NET_OP_TAIL_ADD    x:u16 y:u16         snake grew, append a segment
+//   NET_OP_FRUIT       slot:u8 status:u8 x:u16 y:u16
+//   NET_OP_SCORE       current:u32 record:u32
+//   NET_OP_STATUS      direction:u8 collided:u8
+//
+// keyframe payload:
+//   board_size:u16 current:u32 record:u32 direction:u8 collided:u8
+//   snake_length:u16 [x:u16 y:u16] * snake_length (head to tail)
+//   fruit_count:u8 [status:u8 x:u16 y:u16] * fruit_count
+
+#define NET_FRAME_HEADER_SIZE 12
+#define NET_DELTA_MAX_SIZE 256
+// a snake filling the board of the build's preset, plus every fruit
+#define NET_KEYFRAME_MAX_SIZE (14 + 4 * BOARD_CELLS + 1 + 5 * FRUIT_POOL_LENGTH)
+
+typedef enum net_frame_type_t
+{
+	NET_FRAME_KEYFRAME = 1,
+	NET_FRAME_DELTA	   = 2
+} net_frame_type_t;
+
+typedef enum net_op_t
+{
+	NET_OP_HEAD_ADD	   = 1,
+	NET_OP_TAIL_REMOVE = 2,
+	NET_OP_TAIL_ADD	   = 3,
+	NET_OP_FRUIT	   = 4,
+	NET_OP_SCORE	   = 5,
+	NET_OP_STATUS	   = 6
+} net_op_t;
+
+typedef struct net_frame_header_t
+{
+	uint8_t	 type;
+	uint8_t	 reserved[3];
+	uint32_t length;
+	uint32_t tick;
+} net_frame_header_t;
+
+// Fixed capacity byte buffer, writes past the end are dropped and
+// flagged so the caller can fall back to a keyframe.
+typedef struct net_buffer_t
+{
+	uint8_t *data;
+	uint32_t length;
+	uint32_t size;
+	bool	 overflow;
+} net_buffer_t;
+
+// Read cursor over a received payload.
+typedef struct net_reader_t
+{
+	const uint8_t *data;
+	uint32_t	   length;
+	uint32_t	   offset;
+	bool		   overflow;
+} net_reader_t;
+
+void	 net_buffer_put_u8(net_buffer_t *buffer, uint8_t val);
+void	 net_buffer_put_u16(net_buffer_t *buffer, uint16_t val);
+void	 net_buffer_put_u32(net_buffer_t *buffer, uint32_t val);
+uint8_t	 net_reader_get_u8(net_reader_t *reader);
+uint16_t net_reader_get_u16(net_reader_t *reader);
+uint32_t net_reader_get_u32(net_reader_t *reader);
+
+#endif
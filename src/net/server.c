@@ -0,0 +1,402 @@
+#define _POSIX_C_SOURCE 200809L
+#include "server.h"
+#include "../common.h"
+
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// Authoritative game server over a unix domain socket.
+// The game loop stays the only writer of the game state, the server
+// just mirrors every tick as a delta frame to the connected clients.
+// Sockets are non-blocking and every client owns an outbound queue:
+// when a slow client can't keep up its queue is dropped and the client
+// gets resynchronized with a keyframe, the tick never waits for it.
+
+typedef struct client_t
+{
+	int		 fd;
+	bool	 synced;   // got a keyframe, deltas can be applied
+	bool	 watching; // EPOLLOUT registered
+	uint32_t begin;	 // first unsent byte
+	uint32_t end;	 // one past the last queued byte
+	uint32_t frame;	 // start of the frame 'begin' belongs to
+	uint8_t	 queue[SERVER_QUEUE_SIZE];
+} client_t;
+
+static const char				*socket_path	  = NULL;
+static int						 listen_fd		  = -1;
+static int						 epoll_fd		  = -1;
+static client_t					 clients[SERVER_MAX_CLIENTS];
+static server_keyframe_writer_t	 keyframe_writer  = NULL;
+static uint32_t					 last_tick		  = 0;
+static uint32_t					 delta_count	  = 0;
+static uint8_t					 keyframe_data[NET_KEYFRAME_MAX_SIZE];
+
+#ifdef __linux__
+
+static void client_accept(void);
+static void client_close(client_t *client);
+static bool client_enqueue(client_t *client, uint8_t type, uint32_t tick, const uint8_t *payload, uint32_t length);
+static void client_flush(client_t *client);
+static void client_drain_input(client_t *client);
+static void client_watch_output(client_t *client, bool enabled);
+static void send_keyframes(void);
+
+bool server_open(const char *path)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+	if (strlen(path) >= sizeof(addr.sun_path))
+	{
+		return false;
+	}
+
+	strcpy(addr.sun_path, path);
+	unlink(path);
+
+	listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if (listen_fd < 0)
+	{
+		return false;
+	}
+
+	fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+
+	if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+		listen(listen_fd, SERVER_MAX_CLIENTS) < 0)
+	{
+		close(listen_fd);
+		listen_fd = -1;
+		return false;
+	}
+
+	epoll_fd = epoll_create1(0);
+	ASSERT(epoll_fd >= 0);
+
+	struct epoll_event event = { .events = EPOLLIN, .data.ptr = NULL };
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event);
+
+	for (uint8_t i = 0; i < SERVER_MAX_CLIENTS; i++)
+	{
+		clients[i].fd = -1;
+	}
+
+	socket_path = path;
+
+	return true;
+}
+
+void server_close(void)
+{
+	if (listen_fd < 0)
+	{
+		return;
+	}
+
+	for (uint8_t i = 0; i < SERVER_MAX_CLIENTS; i++)
+	{
+		if (clients[i].fd >= 0)
+		{
+			client_close(&clients[i]);
+		}
+	}
+
+	close(epoll_fd);
+	close(listen_fd);
+	unlink(socket_path);
+	epoll_fd = listen_fd = -1;
+}
+
+bool server_is_open(void)
+{
+	return listen_fd >= 0;
+}
+
+void server_poll(void)
+{
+	if (listen_fd < 0)
+	{
+		return;
+	}
+
+	struct epoll_event events[SERVER_MAX_CLIENTS + 1];
+	int				   count = epoll_wait(epoll_fd, events, SERVER_MAX_CLIENTS + 1, 0);
+
+	for (int i = 0; i < count; i++)
+	{
+		client_t *client = events[i].data.ptr;
+
+		if (!client)
+		{
+			client_accept();
+			continue;
+		}
+
+		if (events[i].events & (EPOLLERR | EPOLLHUP))
+		{
+			client_close(client);
+			continue;
+		}
+
+		if (events[i].events & EPOLLIN)
+		{
+			client_drain_input(client);
+		}
+
+		if (client->fd >= 0 && (events[i].events & EPOLLOUT))
+		{
+			client_flush(client);
+		}
+	}
+
+	send_keyframes();
+}
+
+void server_set_keyframe_writer(server_keyframe_writer_t writer)
+{
+	keyframe_writer = writer;
+}
+
+void server_broadcast_delta(uint32_t tick, const net_buffer_t *delta)
+{
+	if (listen_fd < 0)
+	{
+		return;
+	}
+
+	last_tick = tick;
+
+	if (delta->overflow || ++delta_count >= SERVER_KEYFRAME_INTERVAL)
+	{
+		server_request_keyframe();
+	}
+
+	if (delta->overflow || delta->length == 0)
+	{
+		return;
+	}
+
+	for (uint8_t i = 0; i < SERVER_MAX_CLIENTS; i++)
+	{
+		client_t *client = &clients[i];
+
+		if (client->fd >= 0 && client->synced)
+		{
+			client_enqueue(client, NET_FRAME_DELTA, tick, delta->data, delta->length);
+			client_flush(client);
+		}
+	}
+}
+
+void server_request_keyframe(void)
+{
+	delta_count = 0;
+
+	for (uint8_t i = 0; i < SERVER_MAX_CLIENTS; i++)
+	{
+		clients[i].synced = false;
+	}
+}
+
+static void send_keyframes(void)
+{
+	net_buffer_t keyframe = { .data = keyframe_data, .size = NET_KEYFRAME_MAX_SIZE };
+
+	for (uint8_t i = 0; i < SERVER_MAX_CLIENTS; i++)
+	{
+		client_t *client = &clients[i];
+
+		if (client->fd < 0 || client->synced || !keyframe_writer)
+		{
+			continue;
+		}
+
+		// the keyframe is encoded once and shared by every client waiting for it
+		if (!keyframe.length)
+		{
+			keyframe_writer(&keyframe);
+			ASSERT(!keyframe.overflow);
+		}
+
+		client->synced = client_enqueue(client, NET_FRAME_KEYFRAME, last_tick, keyframe.data, keyframe.length);
+		client_flush(client);
+	}
+}
+
+static void client_accept(void)
+{
+	int fd;
+
+	while ((fd = accept(listen_fd, NULL, NULL)) >= 0)
+	{
+		client_t *client = NULL;
+
+		for (uint8_t i = 0; i < SERVER_MAX_CLIENTS && !client; i++)
+		{
+			client = clients[i].fd < 0 ? &clients[i] : NULL;
+		}
+
+		if (!client)
+		{
+			close(fd);
+			continue;
+		}
+
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+		client->fd		 = fd;
+		client->synced	 = false;
+		client->watching = false;
+		client->begin = client->end = client->frame = 0;
+
+		struct epoll_event event = { .events = EPOLLIN, .data.ptr = client };
+		epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+	}
+}
+
+static void client_close(client_t *client)
+{
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
+	close(client->fd);
+	client->fd = -1;
+}
+
+static bool client_enqueue(client_t *client, uint8_t type, uint32_t tick, const uint8_t *payload, uint32_t length)
+{
+	uint32_t size = NET_FRAME_HEADER_SIZE + length;
+
+	if (client->end + size > SERVER_QUEUE_SIZE && client->frame > 0)
+	{
+		memmove(client->queue, client->queue + client->frame, client->end - client->frame);
+		client->begin -= client->frame;
+		client->end -= client->frame;
+		client->frame = 0;
+	}
+
+	if (client->end + size > SERVER_QUEUE_SIZE)
+	{
+		// queue is full: keep the frame being sent (if any) so the stream
+		// stays aligned, drop the rest and resync with a keyframe
+		net_frame_header_t header;
+		memcpy(&header, client->queue + client->frame, sizeof(header));
+		client->end	   = client->begin > client->frame ? client->frame + NET_FRAME_HEADER_SIZE + header.length : client->frame;
+		client->begin  = client->end > client->frame ? client->begin : client->end;
+		client->synced = false;
+
+		if (type == NET_FRAME_DELTA || client->end + size > SERVER_QUEUE_SIZE)
+		{
+			return false;
+		}
+	}
+
+	net_frame_header_t header = { .type = type, .length = length, .tick = tick };
+	memcpy(client->queue + client->end, &header, NET_FRAME_HEADER_SIZE);
+	memcpy(client->queue + client->end + NET_FRAME_HEADER_SIZE, payload, length);
+	client->end += size;
+
+	return true;
+}
+
+static void client_flush(client_t *client)
+{
+	while (client->begin < client->end)
+	{
+		ssize_t sent = send(client->fd, client->queue + client->begin, client->end - client->begin, MSG_NOSIGNAL);
+
+		if (sent < 0)
+		{
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				break;
+			}
+
+			client_close(client);
+			return;
+		}
+
+		client->begin += sent;
+	}
+
+	// move 'frame' to the frame that contains 'begin'
+	while (client->frame < client->begin)
+	{
+		net_frame_header_t header;
+		memcpy(&header, client->queue + client->frame, sizeof(header));
+
+		if (client->frame + NET_FRAME_HEADER_SIZE + header.length > client->begin)
+		{
+			break;
+		}
+
+		client->frame += NET_FRAME_HEADER_SIZE + header.length;
+	}
+
+	if (client->begin == client->end)
+	{
+		client->begin = client->end = client->frame = 0;
+	}
+
+	client_watch_output(client, client->begin < client->end);
+}
+
+static void client_drain_input(client_t *client)
+{
+	uint8_t buffer[256];
+	ssize_t received;
+
+	// spectators have nothing to say, just detect hang ups
+	while ((received = recv(client->fd, buffer, sizeof(buffer), 0)) > 0)
+	{
+	}
+
+	if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+	{
+		client_close(client);
+	}
+}
+
+static void client_watch_output(client_t *client, bool enabled)
+{
+	if (client->watching == enabled)
+	{
+		return;
+	}
+
+	client->watching = enabled;
+	struct epoll_event event = { .events = EPOLLIN | (enabled ? EPOLLOUT : 0), .data.ptr = client };
+	epoll_ctl(epoll_fd, EPOLL_CTL_MOD, client->fd, &event);
+}
+
+#else
+
+bool server_open(const char *path)
+{
+	(void)path;
+	(void)socket_path;
+	(void)epoll_fd;
+	(void)clients;
+	(void)keyframe_data;
+	return false;
+}
+
+void server_close(void) {}
+bool server_is_open(void) { return false; }
+void server_poll(void) {}
+void server_set_keyframe_writer(server_keyframe_writer_t writer) { keyframe_writer = writer; }
+void server_broadcast_delta(uint32_t tick, const net_buffer_t *delta)
+{
+	(void)tick;
+	(void)delta;
+	(void)last_tick;
+	(void)delta_count;
+}
+void server_request_keyframe(void) {}
+
+#endif
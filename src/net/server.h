@@ -0,0 +1,23 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "../defs.h"
+#include "protocol.h"
+
+#define SERVER_MAX_CLIENTS 16
+// room for a whole keyframe and the deltas queued behind it
+#define SERVER_QUEUE_SIZE (NET_FRAME_HEADER_SIZE + NET_KEYFRAME_MAX_SIZE + 64 * 1024)
+#define SERVER_KEYFRAME_INTERVAL 40 // deltas between periodic keyframes
+
+// Fills 'buffer' with the keyframe payload of the current game state.
+typedef void (*server_keyframe_writer_t)(net_buffer_t *buffer);
+
+bool server_open(const char *path);
+void server_close(void);
+bool server_is_open(void);
+void server_poll(void);
+void server_set_keyframe_writer(server_keyframe_writer_t writer);
+void server_broadcast_delta(uint32_t tick, const net_buffer_t *delta);
+void server_request_keyframe(void);
+
+#endif
@@ -0,0 +1,218 @@
+#define _POSIX_C_SOURCE 200809L
+#include "recorder.h"
+#include "common.h"
+#include "mem.h"
+#include "terminal.h"
+#include <pthread.h>
+
+// Records the terminal output as an asciicast v2 stream
+// (https://docs.asciinema.org/manual/asciicast/v2/).
+// The terminal sink just copies every output chunk and its timestamp
+// into the capture buffer. A background writer swaps the capture and
+// flush buffers, JSON-encodes the events and does the file I/O, so
+// recording never blocks the game loop on the disk. Both buffers are
+// allocated up front: when the writer falls behind and the capture
+// buffer fills up, chunks are dropped and counted instead of growing
+// it on the game loop.
+
+typedef struct record_buffer_t
+{
+	uint8_t *data;
+	size_t	 length;
+	size_t	 size;
+} record_buffer_t;
+
+typedef struct record_event_t
+{
+	float64_t time;
+	uint32_t  length;
+} record_event_t;
+
+static FILE			  *file = NULL;
+static pthread_t	   writer;
+static pthread_mutex_t mutex   = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  pending = PTHREAD_COND_INITIALIZER;
+static bool			   running = false;
+static float64_t	   start_time;
+static record_buffer_t capture;
+static record_buffer_t flush;
+static uint64_t		   dropped_chunks = 0;
+static uint64_t		   dropped_bytes  = 0;
+
+static void		 capture_output(const void *data, size_t length);
+static void		*write_events(void *arg);
+static void		 encode_events(record_buffer_t *buffer);
+static void		 buffer_alloc(record_buffer_t *buffer);
+static float64_t get_time(void);
+
+bool recorder_open(const char *path, uint16_t width, uint16_t height)
+{
+	file = fopen(path, "w");
+
+	if (!file)
+	{
+		return false;
+	}
+
+	const char *term = getenv("TERM");
+	fprintf(file, "{\"version\": 2, \"width\": %d, \"height\": %d, \"timestamp\": %ld, \"env\": {\"TERM\": \"%s\"}}\n",
+			width, height, (long)time(NULL), term ? term : "xterm");
+
+	buffer_alloc(&capture);
+	buffer_alloc(&flush);
+	start_time = get_time();
+	running	   = true;
+
+	ASSERT(!pthread_create(&writer, NULL, &write_events, NULL));
+	terminal_add_sink(&capture_output);
+
+	return true;
+}
+
+void recorder_close(void)
+{
+	if (!file)
+	{
+		return;
+	}
+
+	terminal_remove_sink(&capture_output);
+
+	pthread_mutex_lock(&mutex);
+	running = false;
+	pthread_cond_signal(&pending);
+	pthread_mutex_unlock(&mutex);
+	pthread_join(writer, NULL);
+
+	fclose(file);
+	file = NULL;
+	mem_free(capture.data);
+	mem_free(flush.data);
+	memset(&capture, 0, sizeof(capture));
+	memset(&flush, 0, sizeof(flush));
+
+	if (dropped_chunks)
+	{
+		fprintf(stderr, "recording dropped %llu output chunks (%llu bytes), the disk was too slow\n",
+				(unsigned long long)dropped_chunks, (unsigned long long)dropped_bytes);
+	}
+}
+
+static void capture_output(const void *data, size_t length)
+{
+	record_event_t event = { .time = get_time() - start_time, .length = length };
+
+	pthread_mutex_lock(&mutex);
+
+	bool was_empty = capture.length == 0;
+
+	if (capture.length + sizeof(event) + length > capture.size)
+	{
+		dropped_chunks++;
+		dropped_bytes += length;
+		pthread_mutex_unlock(&mutex);
+		return;
+	}
+
+	memcpy(capture.data + capture.length, &event, sizeof(event));
+	memcpy(capture.data + capture.length + sizeof(event), data, length);
+	capture.length += sizeof(event) + length;
+
+	// the writer only sleeps when it has nothing left to do
+	if (was_empty)
+	{
+		pthread_cond_signal(&pending);
+	}
+
+	pthread_mutex_unlock(&mutex);
+}
+
+static void *write_events(void *arg)
+{
+	(void)arg;
+	bool done = false;
+
+	while (!done)
+	{
+		pthread_mutex_lock(&mutex);
+
+		while (running && capture.length == 0)
+		{
+			pthread_cond_wait(&pending, &mutex);
+		}
+
+		record_buffer_t swap = capture;
+		capture				 = flush;
+		flush				 = swap;
+		done				 = !running;
+
+		pthread_mutex_unlock(&mutex);
+
+		encode_events(&flush);
+		flush.length = 0;
+	}
+
+	return NULL;
+}
+
+static void encode_events(record_buffer_t *buffer)
+{
+	size_t offset = 0;
+
+	while (offset < buffer->length)
+	{
+		record_event_t event;
+		memcpy(&event, buffer->data + offset, sizeof(event));
+		offset += sizeof(event);
+
+		fprintf(file, "[%.6f, \"o\", \"", event.time);
+
+		for (uint32_t i = 0; i < event.length; i++)
+		{
+			uint8_t ch = buffer->data[offset + i];
+
+			if (ch == '"' || ch == '\\')
+			{
+				fputc('\\', file);
+				fputc(ch, file);
+			}
+			else if (ch == '\n')
+			{
+				fputs("\\n", file);
+			}
+			else if (ch == '\r')
+			{
+				fputs("\\r", file);
+			}
+			else if (ch < 0x20 || ch >= 0x7f)
+			{
+				fprintf(file, "\\u%04x", ch);
+			}
+			else
+			{
+				fputc(ch, file);
+			}
+		}
+
+		fputs("\"]\n", file);
+		offset += event.length;
+	}
+
+	fflush(file);
+}
+
+static void buffer_alloc(record_buffer_t *buffer)
+{
+	buffer->data = mem_alloc(RECORDER_BUFFER_SIZE);
+	ASSERT(buffer->data);
+	buffer->size   = RECORDER_BUFFER_SIZE;
+	buffer->length = 0;
+}
+
+static float64_t get_time(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec + (now.tv_nsec / 1e9);
+}
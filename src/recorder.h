@@ -0,0 +1,11 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include "defs.h"
+
+#define RECORDER_BUFFER_SIZE (256 * 1024)
+
+bool recorder_open(const char *path, uint16_t width, uint16_t height);
+void recorder_close(void);
+
+#endif
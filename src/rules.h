@@ -0,0 +1,59 @@
+#ifndef RULES_H
+#define RULES_H
+
+#include "defs.h"
+
+// Rules of the game, shared by the game screen and the batch engine
+// (batch.h) so both play the same game.
+
+#define FRUIT_POOL_LENGTH 6
+
+typedef enum snake_direction_t
+{
+	SNAKE_DIRECTION_IDLE   = 0,
+	SNAKE_DIRECTION_LEFT   = 1,
+	SNAKE_DIRECTION_RIGHT  = 2,
+	SNAKE_DIRECTION_TOP	   = 3,
+	SNAKE_DIRECTION_BOTTOM = 4
+} snake_direction_t;
+
+typedef enum fruit_status_t
+{
+	FRUIT_STATUS_IDLE	= 0,
+	FRUIT_STATUS_ACTIVE = 1,
+	FRUIT_STATUS_EATEN	= 2
+} fruit_status_t;
+
+static const float32_t snake_speed_init			= 0.5; // seconds per move
+static const float32_t snake_speed_max			= 0.1;
+static const float32_t snake_speed_acceleration = 0.01; // per fruit eaten
+
+static const float32_t fruit_lifetime			= 15;
+static const uint8_t   fruit_pool_length		= FRUIT_POOL_LENGTH;
+static const uint8_t   fruit_spawn_delay_min	= 2; // seconds between spawns, plus rand() % range
+static const uint8_t   fruit_spawn_delay_range	= 4;
+static const uint32_t  points_movement			= 10;
+static const uint32_t  points_fruit_eaten		= 50;
+
+static const uint32_t sim_tick_rate = 60; // simulation steps per second
+
+// Random numbers of the headless modes (batch.h, arena.h, world.h),
+// the scripted --train keys and the autopilot cycle: xorshift32, runs
+// replay from their seed.
+static inline uint32_t random_next(uint32_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+
+	return *state;
+}
+
+// state for a seed, 'stream' tells apart the generators sharing it;
+// never 0, xorshift never leaves 0
+static inline uint32_t random_seed(uint32_t seed, uint32_t stream)
+{
+	return (seed * 2654435761u + stream) | 1;
+}
+
+#endif
@@ -1,14 +1,36 @@
+#define _POSIX_C_SOURCE 200809L
 #include "screen_game.h"
+#include "../autopilot.h"
+#include "../board.h"
+#include "../bot.h"
 #include "../common.h"
+#include "../compositor.h"
 #include "../data_structures/data_structures.h"
+#include "../mem.h"
+#include "../net/server.h"
+#include "../rules.h"
+#include "../stats.h"
+#include "../trace.h"
+#include <pthread.h>
 
 extern int		 g_key;
 extern score_t	 g_score;
 extern float32_t g_delta_time;
+extern options_t g_options;
 
-#define COORDS_TO_INDEX(x, y) (win_board_height * y + x)
-#define SET_BOARD_CELL_VAL(x, y, val) (*(board_model + COORDS_TO_INDEX(x, y)) = val, val ? board_cell_pool_remove(x, y) : board_cell_pool_add(x, y))
-#define GET_BOARD_CELL_VAL(x, y) (*(board_model + COORDS_TO_INDEX(x, y)))
+#define INPUT_QUEUE_SIZE 16 // power of two
+
+#define SET_BOARD_CELL_VAL(x, y, val) (count_cell(x, y, val), *(board_model + BOARD_INDEX(x, y)) = val, val ? board_cell_pool_remove(x, y) : board_cell_pool_add(x, y))
+#define GET_BOARD_CELL_VAL(x, y) (*(board_model + BOARD_INDEX(x, y)))
+
+// The minimap splits the board in square blocks and shades each one by
+// the number of snake cells in it. The counts are kept up to date as
+// cells are set and cleared, so drawing the minimap never looks at the
+// board itself.
+#define MINIMAP_BLOCK_SHIFT 4 // 16x16 board cells per minimap cell
+#define MINIMAP_BLOCK_CELLS (1 << (MINIMAP_BLOCK_SHIFT * 2))
+#define MINIMAP_SIZE ((BOARD_SIZE + (1 << MINIMAP_BLOCK_SHIFT) - 1) >> MINIMAP_BLOCK_SHIFT)
+#define MINIMAP_INDEX(x, y) (((y) >> MINIMAP_BLOCK_SHIFT) * MINIMAP_SIZE + ((x) >> MINIMAP_BLOCK_SHIFT))
 
 #define CH_SNAKE_TONGE_LEFT ACS_LLCORNER
 #define CH_SNAKE_TONGE_RIGHT ACS_URCORNER
@@ -23,54 +45,80 @@ typedef struct snake_node_t
 	struct snake_node_t *prev_node; // ==>
 } snake_node_t;
 
-typedef enum snake_direction_t
-{
-	SNAKE_DIRECTION_IDLE   = 0,
-	SNAKE_DIRECTION_LEFT   = 1,
-	SNAKE_DIRECTION_RIGHT  = 2,
-	SNAKE_DIRECTION_TOP	   = 3,
-	SNAKE_DIRECTION_BOTTOM = 4
-} snake_direction_t;
-
 typedef struct snake_t
 {
 	snake_node_t	 *first_node;
 	snake_node_t	 *head;
 	snake_node_t	 *tail;
 	chtype			  tonge_ch;
-	float32_t		  elapsed_time;
-	float32_t		  collided_elapsed_time;
 	float32_t		  speed;
 	float32_t		  max_speed;
 	float32_t		  acceleration;
-	uint8_t			  length; // number of active nodes
+	uint16_t		  length; // number of active nodes
 	snake_direction_t direction;
 	bool			  collided;
+	bool			  trapped;	// doomed, the head's region can't outlast the body
+	bool			  blink;	// collided, drawn in red
+	bool			  finished; // the game over animation is done
 } snake_t;
 
-typedef enum fruit_status_t
-{
-	FRUIT_STATUS_IDLE	= 0,
-	FRUIT_STATUS_ACTIVE = 1,
-	FRUIT_STATUS_EATEN	= 2
-} fruit_status_t;
-
 typedef struct fruit_t
 {
 	vec2_t		   pos;
-	float32_t	   lifetime;
-	float32_t	   elapsed_time;
+	uint32_t	   timer; // lifetime, while active
 	fruit_status_t status;
 } fruit_t;
 
+// Active and eaten fruits are also indexed by board cell (fruit slot as
+// payload), so checking the cells under the head and the tail is a
+// lookup instead of a scan of the pool.
 typedef struct fruit_pool_t
 {
-	fruit_t	 *fruits;
-	float32_t elapsed_time;
-	float32_t rand_time_to_activate_fruit;
-	uint8_t	  length; // number of fruits
+	fruit_t		*fruits;
+	sparse_map_t cells;
+	uint8_t		 length;		// number of fruits
+	bool		 spawn_waiting; // the spawn is due, for an idle slot or a cell to spawn on
 } fruit_pool_t;
 
+// Everything timed in a game is a timer on the wheel, in simulation
+// ticks: a step only does the work of the timers expiring on it, and
+// the simulation thread sleeps until the next one (or a key).
+typedef enum game_timer_t
+{
+	GAME_TIMER_MOVE		 = 0, // the snake moves a cell
+	GAME_TIMER_SPAWN	 = 1, // an idle fruit slot spawns
+	GAME_TIMER_BLINK	 = 2, // the collided snake changes color
+	GAME_TIMER_GAME_OVER = 3,
+	GAME_TIMER_FRUIT	 = 4 // plus the slot, the fruit expires
+} game_timer_t;
+
+// The simulation runs on its own thread at a fixed tick rate and
+// publishes a copy of what the renderer needs after every tick through
+// a triple buffer: a slow terminal flush never delays the next snake
+// move, and the renderer always draws the latest complete state.
+// Only the board cells under the camera are copied, so publishing and
+// drawing a frame cost the same on any board size.
+typedef struct game_snapshot_t
+{
+	bool			  cells[BOARD_SIZE * BOARD_SIZE];	   // view_rows x view_cols cells under the camera
+	uint16_t		  blocks[MINIMAP_SIZE * MINIMAP_SIZE]; // snake cells per minimap block
+	vec2_t			  camera;							   // board cell at the top left of the view
+	uint16_t		  view_rows;						   // the view the cells were copied for
+	uint16_t		  view_cols;
+	vec2_t			  head;
+	vec2_t			  fruits[FRUIT_POOL_LENGTH]; // active fruits
+	uint16_t		  snake_length;
+	uint8_t			  fruits_length;
+	score_t			  score;
+	chtype			  tonge_ch;
+	snake_direction_t direction;
+	bool			  collided;
+	bool			  trapped;
+	bool			  blink;
+	bool			  finished;
+	uint64_t		  sim_ticks;
+} game_snapshot_t;
+
 // As fruits are placed randomly on board,
 // we must check if the generated random cell (x,y)
 // is available on 'board_model' and keep generating random values
@@ -80,110 +128,206 @@ typedef struct fruit_pool_t
 // find a free cell.
 // A better alternative is to store all available cells in a pool,
 // so we only need to generate a random index to retrieve a cell.
-// Sparse set offers fast index search/insert/delete operations and
-// a companion 'cells' vector stores its values.
-// for more information about sparse sets: https://www.geeksforgeeks.org/sparse-set/
+// The pool is a bitset with one bit per board cell: selecting the
+// k-th free cell uses rank/select over per-word popcounts, so picking
+// a uniformly random free cell is O(log n) and the pool costs one bit
+// per cell plus a small index.
 typedef struct board_cell_pool_t
 {
-	sparse_set_t indexes;
-	vec2_t		*cells;
+	bitset_t free_cells;
 } board_cell_pool_t;
 
-static const uint8_t win_board_height  = 20;
-static const uint8_t win_board_width   = win_board_height * 2;
-static const uint8_t win_board_padding = 2;
-static const uint8_t win_score_width   = win_board_width;
-static const uint8_t win_score_height  = 1;
-
-static const float32_t snake_speed_init			= 0.5;
-static const float32_t snake_speed_max			= 0.1;
-static const float32_t snake_speed_acceleration = 0.01;
-
-static const float32_t fruit_lifetime	  = 15;
-static const uint8_t   fruit_pool_length  = 6;
-static const uint32_t  points_movement	  = 10;
-static const uint32_t  points_fruit_eaten = 50;
-
-static WINDOW *win_board;
-static WINDOW *win_score;
+static const uint8_t   win_score_height = 1;
+static const float32_t collided_blink	= 0.2; // seconds per color
+static const float32_t game_over_delay	= 4;   // seconds from the collision to the result screen
+
+// low bandwidth glyphs, indexed by snake_direction_t
+static const chtype head_glyphs[] = { '<', '<', '>', '^', 'v' };
+
+static WINDOW  *win_board	= NULL;
+static WINDOW  *win_score	= NULL;
+static WINDOW  *win_minimap = NULL; // only when the board doesn't fit the terminal
+static uint16_t win_board_height;
+static uint16_t win_board_width;
+static uint16_t win_score_width;
+static uint16_t win_minimap_width = 0;
+static uint8_t	cell_width; // terminal columns per board cell, 1 or 2
+static uint16_t view_rows;	// board cells shown by the camera
+static uint16_t view_cols;
+// view_rows << 16 | view_cols, read by the simulation when it publishes
+static uint32_t view_size;
 
 static snake_t			 snake;
 static fruit_pool_t		 fruit_pool;
 static board_cell_pool_t board_cell_pool;
+// Buffers and windows are allocated by the first game and reused by
+// the next ones: a restart restores the board and the free cell pool
+// from these templates instead of rebuilding them cell by cell.
+static bool				 allocated = false; // windows
+static bool				 prepared  = false; // buffers, see screen_game_prepare
+static board_cell_pool_t board_cell_pool_template;
+static bool				*board_model_template = NULL;
 // board_model is required to keep track which cells are filled
-// with snake body nodes and detect collisions quickly
+// with snake body nodes and detect collisions quickly.
+// Walls are filled cells too, so a collision is a single load.
 static bool *board_model = NULL;
-
-static void handle_input(void);
+static uint16_t minimap_blocks[MINIMAP_SIZE * MINIMAP_SIZE];
+static vec2_t	camera; // simulation side, published with every snapshot
+// Packed copy of the board for the flood fill, bit x of row y is set
+// while the cell is free (no wall, no snake). After every move the
+// cells the head can reach are filled in 'reach_rows': fruits only
+// spawn there, and a region too small to wait for the body to move
+// out of the way is a lost game.
+static uint64_t open_rows[BOARD_SIZE * BOARD_ROW_WORDS];
+static uint64_t open_rows_template[BOARD_SIZE * BOARD_ROW_WORDS];
+static uint64_t reach_rows[BOARD_SIZE * BOARD_ROW_WORDS];
+static uint64_t spawn_columns[BOARD_ROW_WORDS]; // BOARD_IN_SPAWN_AREA columns
+static uint32_t open_cells;						// bits set on open_rows
+static uint32_t reachable_cells;				// open cells reached from the head
+// ops applied on the current frame, mirrored to the server clients
+static uint8_t		delta_data[NET_DELTA_MAX_SIZE];
+static net_buffer_t delta = { .data = delta_data, .size = NET_DELTA_MAX_SIZE };
+static uint32_t		tick  = 0;
+
+static pthread_t	   sim_thread;
+static bool			   sim_running = false;
+static uint64_t		   sim_ticks   = 0; // simulation steps, all games
+static timer_wheel_t   timers;			// see game_timer_t
+static pthread_mutex_t sim_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  sim_wake;		   // a key wakes the sleeping simulation up
+static float32_t	   headless_ticks = 0; // due, not simulated yet
+static triple_buffer_t snapshot_buffer;
+static game_snapshot_t snapshots[3];
+static game_snapshot_t *snapshot = &snapshots[0]; // latest state, render side
+// keys read on the render thread, consumed by the simulation
+static int		input_queue[INPUT_QUEUE_SIZE];
+static uint32_t input_head = 0;
+static uint32_t input_tail = 0;
+// bot view, the board model is handed over as is
+static snake_bot_point_t bot_body[BOARD_SIZE * BOARD_SIZE];
+static snake_bot_point_t bot_fruits[FRUIT_POOL_LENGTH];
+
+typedef char bot_cells_check_t[sizeof(bool) == sizeof(uint8_t) ? 1 : -1];
+
+static void allocate(void);
+static void layout(void);
+static void *simulation_run(void *arg);
+static void simulate(uint32_t ticks);
+static uint32_t to_ticks(float32_t seconds);
+static void on_timer(uint32_t payload);
+static void publish_snapshot(void);
+static void follow_head(uint16_t rows, uint16_t cols);
+static int16_t follow_axis(int16_t camera, int16_t head, int16_t view);
+static void count_cell(uint8_t x, uint8_t y, bool val);
+static void input_push(int key);
+static int	input_pop(void);
+static int	bot_key(void);
+static void handle_input(int key);
+static void step_snake(void);
 static void move_snake(void);
-static void update_fruit_pool(void);
+static void spawn_fruit(void);
+static void expire_fruit(uint8_t slot);
 static void check_eaten_fruits(void);
 static void check_collision(void);
+static void update_reach(void);
+static bool is_trapped(void);
+static bool borders_reach(vec2_t pos);
+static uint32_t spawn_cell(void);
+static uint64_t spawn_candidates(uint8_t y, uint8_t word);
 static void board_cell_pool_add(uint8_t x, uint8_t y);
 static void board_cell_pool_remove(uint8_t x, uint8_t y);
 static void save_score(void);
+static void delta_put_fruit(uint8_t slot);
+static void delta_put_status(void);
+static void write_keyframe(net_buffer_t *buffer);
 static void render_board(void);
+static void render_snake_cells(chtype body_ch, chtype head_ch);
 static void render_snake(void);
 static void render_fruits(void);
 static void render_score(void);
+static void render_minimap(void);
 
 void screen_game_init(void)
 {
-	uint8_t offset_y, offset_x;
-	srand(time(NULL));
 	g_score.current = 0;
-	// win init
-	set_offset_yx(win_board_height, win_board_width, &offset_y, &offset_x);
-	win_board = newwin(win_board_height, win_board_width, offset_y, offset_x);
-	scrollok(win_board, TRUE);
-	win_score = newwin(win_score_height, win_score_width, offset_y - 1, offset_x);
-	scrollok(win_score, TRUE);
+
+	if (!allocated)
+	{
+		allocate();
+	}
+
+	// the terminal may have changed since the last game
+	layout();
 
 	// board model init
-	board_model = calloc(sizeof(bool), win_board_height * win_board_height);
-	ASSERT(board_model);
+	memcpy(board_model, board_model_template, sizeof(bool) * BOARD_CELLS);
+	memcpy(open_rows, open_rows_template, sizeof(open_rows));
+	memset(minimap_blocks, 0, sizeof(minimap_blocks));
+	open_cells = (BOARD_SIZE - 2) * (BOARD_SIZE - 2);
 
 	// snake init
-	snake.first_node = snake.head = snake.tail = calloc(sizeof(snake_node_t), win_board_height * win_board_height);
-	ASSERT(snake.first_node);
-
-	snake.direction				= SNAKE_DIRECTION_LEFT;
-	snake.tonge_ch				= CH_SNAKE_TONGE_LEFT;
-	snake.speed					= snake_speed_init;
-	snake.max_speed				= snake_speed_max;
-	snake.acceleration			= snake_speed_acceleration;
-	snake.length				= 1;
-	snake.collided				= false;
-	snake.collided_elapsed_time = 0;
-	snake.elapsed_time			= 0;
+	snake.head = snake.tail = snake.first_node;
+	memset(snake.first_node, 0, sizeof(snake_node_t));
+
+	snake.direction	   = SNAKE_DIRECTION_LEFT;
+	snake.tonge_ch	   = CH_SNAKE_TONGE_LEFT;
+	snake.speed		   = snake_speed_init;
+	snake.max_speed	   = snake_speed_max;
+	snake.acceleration = snake_speed_acceleration;
+	snake.length	   = 1;
+	snake.collided	   = false;
+	snake.trapped	   = false;
+	snake.blink		   = false;
+	snake.finished	   = false;
 
 	// board cell pool init
-	board_cell_pool.indexes = sparse_set_new(win_board_height * win_board_height);
-	board_cell_pool.cells	= malloc(sizeof(vec2_t) * (win_board_height * win_board_height));
-	ASSERT(board_cell_pool.cells);
-
-	// fill available cells, avoiding board edges
-	for (uint8_t y = win_board_padding; y < win_board_height - win_board_padding; y++)
-	{
-		for (uint8_t x = win_board_padding; x < win_board_height - win_board_padding; x++)
-		{
-			uint16_t index = COORDS_TO_INDEX(x, y);
-			sparse_set_add(&board_cell_pool.indexes, index);
-			uint16_t indexes_length = VECTOR_LENGTH(board_cell_pool.indexes.dense);
-			vec2_t	*cell			= (board_cell_pool.cells + indexes_length - 1);
-			(*cell).x				= x;
-			(*cell).y				= y;
-		}
-	}
+	bitset_copy(&board_cell_pool.free_cells, &board_cell_pool_template.free_cells);
 
 	// fruit pool init
-	fruit_pool.length = fruit_pool_length;
-	fruit_pool.fruits = calloc(sizeof(fruit_t), fruit_pool_length);
-	ASSERT(fruit_pool.fruits);
+	fruit_pool.length		 = fruit_pool_length;
+	fruit_pool.spawn_waiting = false;
+	memset(fruit_pool.fruits, 0, sizeof(fruit_t) * fruit_pool_length);
+	sparse_map_clear(&fruit_pool.cells);
 
-	snake.head->curr_pos.x = win_board_height * 0.5;
-	snake.head->curr_pos.y = win_board_height * 0.5;
+	snake.head->curr_pos.x = BOARD_SIZE / 2;
+	snake.head->curr_pos.y = BOARD_SIZE / 2;
 	SET_BOARD_CELL_VAL(snake.head->curr_pos.x, snake.head->curr_pos.y, true);
+	update_reach();
+
+	// camera centered on the head, follow_head keeps it inside the board
+	camera.x = snake.head->curr_pos.x - view_cols / 2;
+	camera.y = snake.head->curr_pos.y - view_rows / 2;
+
+	// new game, clients must drop their mirror
+	tick		 = 0;
+	delta.length = 0;
+	server_set_keyframe_writer(&write_keyframe);
+	server_request_keyframe();
+
+	// the first fruit spawns on the first tick
+	timer_wheel_clear(&timers);
+	timer_wheel_add(&timers, to_ticks(snake.speed), GAME_TIMER_MOVE);
+	timer_wheel_add(&timers, 1, GAME_TIMER_SPAWN);
+	headless_ticks = 0;
+
+	input_head = input_tail = 0;
+	triple_buffer_init(&snapshot_buffer);
+	publish_snapshot();
+	snapshot = &snapshots[triple_buffer_acquire(&snapshot_buffer)];
+
+	// headless sessions step the simulation from the game loop, keeping
+	// them deterministic
+	if (!g_options.headless)
+	{
+		pthread_condattr_t attr;
+		pthread_condattr_init(&attr);
+		pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+		pthread_cond_init(&sim_wake, &attr);
+		pthread_condattr_destroy(&attr);
+
+		sim_running = true;
+		ASSERT(!pthread_create(&sim_thread, NULL, &simulation_run, NULL));
+	}
 
 	render_score();
 	render_board();
@@ -191,48 +335,91 @@ void screen_game_init(void)
 
 void screen_game_dispose(void)
 {
+	if (sim_running)
+	{
+		pthread_mutex_lock(&sim_mutex);
+		__atomic_store_n(&sim_running, false, __ATOMIC_RELEASE);
+		pthread_cond_signal(&sim_wake);
+		pthread_mutex_unlock(&sim_mutex);
+		pthread_join(sim_thread, NULL);
+		pthread_cond_destroy(&sim_wake);
+	}
+
 	save_score();
-	wclear(win_board);
-	wrefresh(win_board);
-	delwin(win_board);
+	werase(win_board);
+	compositor_damage(win_board);
+
+	werase(win_score);
+	compositor_damage(win_score);
+
+	if (win_minimap)
+	{
+		werase(win_minimap);
+		compositor_damage(win_minimap);
+	}
+}
 
-	wclear(win_score);
-	wrefresh(win_score);
-	delwin(win_score);
+void screen_game_release(void)
+{
+	if (allocated)
+	{
+		compositor_remove(win_board);
+		compositor_remove(win_score);
+		delwin(win_board);
+		delwin(win_score);
+		win_board = win_score = NULL;
+
+		if (win_minimap)
+		{
+			compositor_remove(win_minimap);
+			delwin(win_minimap);
+			win_minimap = NULL;
+		}
+
+		allocated = false;
+	}
 
-	free(board_model);
-	free(snake.first_node);
-	free(board_cell_pool.cells);
-	sparse_set_dispose(&board_cell_pool.indexes);
+	if (!prepared)
+	{
+		return;
+	}
+
+	mem_free(board_model);
+	mem_free(board_model_template);
+	mem_free(snake.first_node);
+	mem_free(fruit_pool.fruits);
+	sparse_map_dispose(&fruit_pool.cells);
+	timer_wheel_dispose(&timers);
+	bitset_dispose(&board_cell_pool.free_cells);
+	bitset_dispose(&board_cell_pool_template.free_cells);
+	prepared = false;
 }
 
 bool screen_game_is_completed(void)
 {
-	return snake.collided && snake.collided_elapsed_time > 4;
+	return snapshot->finished;
 }
 
 void screen_game_update(void)
 {
-	if (snake.collided)
+	if (g_key > 0)
 	{
-		snake.collided_elapsed_time += g_delta_time;
-		return;
+		input_push(g_key);
 	}
 
-	handle_input();
-	update_fruit_pool();
-	snake.elapsed_time += g_delta_time;
-
-	if (snake.elapsed_time >= snake.speed)
+	// the game loop's frame time in whole ticks, the rest waits for the
+	// next frame
+	if (g_options.headless)
 	{
-		move_snake();
-		check_eaten_fruits();
-		check_collision();
-
-		SET_BOARD_CELL_VAL(snake.head->curr_pos.x, snake.head->curr_pos.y, true);
-		g_score.current += points_movement;
-		snake.elapsed_time = 0;
+		headless_ticks += g_delta_time * sim_tick_rate;
+		uint32_t ticks = headless_ticks;
+		headless_ticks -= ticks;
+		simulate(ticks);
 	}
+
+	snapshot = &snapshots[triple_buffer_acquire(&snapshot_buffer)];
+	TRACE1(game_update, snapshot->sim_ticks);
+	stats_game(snapshot->sim_ticks, snapshot->score, snapshot->snake_length);
 }
 
 void screen_game_render(void)
@@ -243,47 +430,512 @@ void screen_game_render(void)
 	render_board();
 	render_fruits();
 	render_snake();
-	wrefresh(win_board);
+	compositor_damage(win_board);
+
+	if (win_minimap)
+	{
+		render_minimap();
+	}
 }
 
 void screen_game_window_resized(void)
 {
+	layout();
+	render_score();
+
 	wclear(win_board);
 	render_board();
 	render_fruits();
 	render_snake();
-	wrefresh(win_board);
+	compositor_damage(win_board);
+
+	if (win_minimap)
+	{
+		render_minimap();
+	}
 }
 
-static void handle_input(void)
+// Steps the simulation to the ticks due since the thread started, then
+// sleeps until the next timer expires: a snake waiting for its next
+// move costs no wakeups. A key wakes the thread up early, a server
+// polls its clients every tick.
+static void *simulation_run(void *arg)
 {
-	if (g_key > 0)
+	(void)arg;
+	struct timespec start, now, wake;
+	uint64_t		done	= 0; // ticks simulated
+	uint32_t		wakeups = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	while (__atomic_load_n(&sim_running, __ATOMIC_ACQUIRE))
+	{
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		uint64_t elapsed_ns = (now.tv_sec - start.tv_sec) * 1000000000ULL + now.tv_nsec - start.tv_nsec;
+		uint64_t due		= elapsed_ns * sim_tick_rate / 1000000000ULL;
+
+		// too far behind (suspended process?), don't try to catch up
+		if (due > done + sim_tick_rate)
+		{
+			done = due - 1;
+		}
+
+		// the simulation is the game's update, same guard as the main loop
+		mem_guard(g_options.alloc_guard && wakeups++ > MEM_GUARD_WARMUP_FRAMES);
+		simulate(due - done);
+		mem_guard(false);
+		done = due;
+
+		uint64_t next = timer_wheel_next(&timers);
+		uint64_t most = server_is_open() ? 1 : sim_tick_rate;
+		uint64_t wake_ns;
+
+		// rounded up, the thread never wakes up before the tick is due
+		next	= next < most ? next : most;
+		wake_ns = ((done + next) * 1000000000ULL + sim_tick_rate - 1) / sim_tick_rate + start.tv_nsec;
+
+		wake.tv_sec	 = start.tv_sec + wake_ns / 1000000000ULL;
+		wake.tv_nsec = wake_ns % 1000000000ULL;
+
+		pthread_mutex_lock(&sim_mutex);
+
+		if (input_tail == __atomic_load_n(&input_head, __ATOMIC_ACQUIRE) && __atomic_load_n(&sim_running, __ATOMIC_ACQUIRE))
+		{
+			pthread_cond_timedwait(&sim_wake, &sim_mutex, &wake);
+		}
+
+		pthread_mutex_unlock(&sim_mutex);
+	}
+
+	return NULL;
+}
+
+// 'ticks' steps at once, only the ones with an expiring timer do any
+// work. Keys are handled first, no ticks only handles the keys.
+static void simulate(uint32_t ticks)
+{
+	int key;
+
+	sim_ticks += ticks;
+
+	while ((key = input_pop()) != ERR)
+	{
+		if (!snake.collided)
+		{
+			handle_input(key);
+		}
+	}
+
+	timer_wheel_advance(&timers, ticks, &on_timer);
+
+	if (delta.length || delta.overflow)
+	{
+		server_broadcast_delta(tick, &delta);
+		delta.length   = 0;
+		delta.overflow = false;
+	}
+
+	publish_snapshot();
+	server_poll();
+}
+
+static uint32_t to_ticks(float32_t seconds)
+{
+	return seconds * sim_tick_rate + 0.5f;
+}
+
+static void on_timer(uint32_t payload)
+{
+	switch (payload)
+	{
+	case GAME_TIMER_MOVE:
+		step_snake();
+		break;
+	case GAME_TIMER_SPAWN:
+		spawn_fruit();
+		break;
+	case GAME_TIMER_BLINK:
+		snake.blink = !snake.blink;
+		timer_wheel_add(&timers, to_ticks(collided_blink), GAME_TIMER_BLINK);
+		break;
+	case GAME_TIMER_GAME_OVER:
+		snake.finished = true;
+		break;
+	default:
+		expire_fruit(payload - GAME_TIMER_FRUIT);
+		break;
+	}
+}
+
+// the move timer, the next one is set at the snake's current speed
+static void step_snake(void)
+{
+	if (bot_is_active() || autopilot_is_active())
+	{
+		handle_input(bot_key());
+	}
+
+	move_snake();
+	check_eaten_fruits();
+	check_collision();
+
+	SET_BOARD_CELL_VAL(snake.head->curr_pos.x, snake.head->curr_pos.y, true);
+	g_score.current += points_movement;
+	tick++;
+
+	net_buffer_put_u8(&delta, NET_OP_SCORE);
+	net_buffer_put_u32(&delta, g_score.current);
+	net_buffer_put_u32(&delta, g_score.record);
+
+	if (snake.collided)
+	{
+		// nothing moves, spawns or expires anymore: the game over animation
+		delta_put_status();
+		timer_wheel_clear(&timers);
+		timer_wheel_add(&timers, to_ticks(collided_blink), GAME_TIMER_BLINK);
+		timer_wheel_add(&timers, to_ticks(game_over_delay), GAME_TIMER_GAME_OVER);
+		return;
+	}
+
+	update_reach();
+	timer_wheel_add(&timers, to_ticks(snake.speed), GAME_TIMER_MOVE);
+
+	// the move may have freed a slot (growth) or a cell in the region
+	if (fruit_pool.spawn_waiting)
+	{
+		spawn_fruit();
+	}
+}
+
+static void publish_snapshot(void)
+{
+	game_snapshot_t *back = &snapshots[snapshot_buffer.back];
+	uint32_t		 size = __atomic_load_n(&view_size, __ATOMIC_RELAXED);
+	uint16_t		 rows = size >> 16, cols = size & 0xffff;
+
+	follow_head(rows, cols);
+
+	for (uint16_t row = 0; row < rows; row++)
+	{
+		memcpy(&back->cells[row * cols], board_model + BOARD_INDEX(camera.x, camera.y + row), sizeof(bool) * cols);
+	}
+
+	memcpy(back->blocks, minimap_blocks, sizeof(minimap_blocks));
+	back->camera		= camera;
+	back->view_rows		= rows;
+	back->view_cols		= cols;
+	back->head			= snake.head->curr_pos;
+	back->snake_length	= snake.length;
+	back->fruits_length = 0;
+
+	for (uint8_t i = 0; i < fruit_pool.length; i++)
+	{
+		if (fruit_pool.fruits[i].status == FRUIT_STATUS_ACTIVE)
+		{
+			back->fruits[back->fruits_length++] = fruit_pool.fruits[i].pos;
+		}
+	}
+
+	back->score		= g_score;
+	back->tonge_ch	= snake.tonge_ch;
+	back->direction = snake.direction;
+	back->collided	= snake.collided;
+	back->trapped	= snake.trapped;
+	back->blink		= snake.blink;
+	back->finished	= snake.finished;
+	back->sim_ticks = sim_ticks;
+
+	triple_buffer_publish(&snapshot_buffer);
+}
+
+// the camera moves when the head gets closer than a quarter of the view
+// to its edges, and stops at the board edges
+static void follow_head(uint16_t rows, uint16_t cols)
+{
+	camera.x = follow_axis(camera.x, snake.head->curr_pos.x, cols);
+	camera.y = follow_axis(camera.y, snake.head->curr_pos.y, rows);
+}
+
+static int16_t follow_axis(int16_t camera, int16_t head, int16_t view)
+{
+	int16_t margin = view / 4;
+
+	if (head < camera + margin)
+	{
+		camera = head - margin;
+	}
+	else if (head >= camera + view - margin)
+	{
+		camera = head - view + margin + 1;
+	}
+
+	if (camera > BOARD_SIZE - view)
+	{
+		camera = BOARD_SIZE - view;
+	}
+
+	return camera < 0 ? 0 : camera;
+}
+
+// called before the cell changes, walls are never set through it
+static void count_cell(uint8_t x, uint8_t y, bool val)
+{
+	if (board_model[BOARD_INDEX(x, y)] != val)
+	{
+		minimap_blocks[MINIMAP_INDEX(x, y)] += val ? 1 : -1;
+		open_rows[y * BOARD_ROW_WORDS + x / 64] ^= (uint64_t)1 << (x % 64);
+		open_cells += val ? -1 : 1;
+	}
+}
+
+// single producer (render thread), single consumer (simulation)
+static void input_push(int key)
+{
+	uint32_t head = input_head;
+
+	if (head - __atomic_load_n(&input_tail, __ATOMIC_ACQUIRE) == INPUT_QUEUE_SIZE)
+	{
+		return; // full, the simulation is far behind anyway
+	}
+
+	input_queue[head % INPUT_QUEUE_SIZE] = key;
+	__atomic_store_n(&input_head, head + 1, __ATOMIC_RELEASE);
+
+	// the simulation may be asleep until its next timer
+	if (sim_running)
+	{
+		pthread_mutex_lock(&sim_mutex);
+		pthread_cond_signal(&sim_wake);
+		pthread_mutex_unlock(&sim_mutex);
+	}
+}
+
+static int input_pop(void)
+{
+	uint32_t tail = input_tail;
+
+	if (tail == __atomic_load_n(&input_head, __ATOMIC_ACQUIRE))
+	{
+		return ERR;
+	}
+
+	int key = input_queue[tail % INPUT_QUEUE_SIZE];
+	__atomic_store_n(&input_tail, tail + 1, __ATOMIC_RELEASE);
+
+	return key;
+}
+
+// asks the bot (or else the autopilot) where to go next, as a key for
+// handle_input
+static int bot_key(void)
+{
+	static const int keys[] = { ERR, KEY_LEFT, KEY_RIGHT, KEY_UP, KEY_DOWN };
+	snake_bot_view_t view	= {
+		  .abi_version	= SNAKE_BOT_ABI_VERSION,
+		  .tick			= tick,
+		  .board_size	= BOARD_SIZE,
+		  .board_stride = BOARD_STRIDE,
+		  .cells		= (const uint8_t *)board_model,
+		  .body			= bot_body,
+		  .fruits		= bot_fruits,
+		  .direction	= snake.direction,
+	};
+
+	for (snake_node_t *node = snake.head; node; node = node->next_node)
+	{
+		bot_body[view.body_length].x   = node->curr_pos.x;
+		bot_body[view.body_length++].y = node->curr_pos.y;
+	}
+
+	for (uint8_t i = 0; i < fruit_pool.length; i++)
+	{
+		if (fruit_pool.fruits[i].status == FRUIT_STATUS_ACTIVE)
+		{
+			bot_fruits[view.fruits_length].x   = fruit_pool.fruits[i].pos.x;
+			bot_fruits[view.fruits_length++].y = fruit_pool.fruits[i].pos.y;
+		}
+	}
+
+	return keys[bot_is_active() ? bot_decide(&view) : autopilot_decide(&view)];
+}
+
+static void allocate(void)
+{
+	screen_game_prepare();
+
+	cell_width = g_options.narrow ? 1 : 2;
+	allocated  = true;
+}
+
+// Sizes the view and the windows from the terminal, on every game and
+// after a resize. The simulation picks the new view up on its next
+// snapshot, the renderer draws each snapshot with the view it was
+// copied for.
+static void layout(void)
+{
+	int		 lines = LINES, cols = COLS;
+	uint16_t offset_y, offset_x;
+
+	view_rows		  = BOARD_SIZE;
+	view_cols		  = BOARD_SIZE;
+	win_minimap_width = 0;
+
+	// a board larger than the terminal is shown through the camera, with
+	// the minimap at its right and a row left for the score
+	if (BOARD_SIZE > lines - 2 || BOARD_SIZE * cell_width > cols)
+	{
+		int rows_left = lines - 2, cols_left = (cols - MINIMAP_SIZE * cell_width - 2) / cell_width;
+
+		win_minimap_width = MINIMAP_SIZE * cell_width + 2;
+		view_rows		  = rows_left < 1 ? 1 : (rows_left < BOARD_SIZE ? rows_left : BOARD_SIZE);
+		view_cols		  = cols_left < 1 ? 1 : (cols_left < BOARD_SIZE ? cols_left : BOARD_SIZE);
+	}
+
+	win_board_height = view_rows;
+	win_board_width	 = view_cols * cell_width;
+	win_score_width	 = view_cols * 2 <= cols ? view_cols * 2 : win_board_width;
+	__atomic_store_n(&view_size, (uint32_t)view_rows << 16 | view_cols, __ATOMIC_RELAXED);
+
+	// no scrolling: the wall corner goes on the last cell of the window
+	if (!win_board)
+	{
+		win_board = newwin(win_board_height, win_board_width, 0, 0);
+		win_score = newwin(win_score_height, win_score_width, 0, 0);
+		scrollok(win_score, TRUE);
+		compositor_add(win_board, 1);
+		compositor_add(win_score, 1);
+	}
+	else
+	{
+		// at the origin first, a window can't grow past the screen
+		mvwin(win_board, 0, 0);
+		mvwin(win_score, 0, 0);
+		wresize(win_board, win_board_height, win_board_width);
+		wresize(win_score, win_score_height, win_score_width);
+	}
+
+	if (win_minimap_width && !win_minimap)
+	{
+		win_minimap = newwin(MINIMAP_SIZE + 2, win_minimap_width, 0, 0);
+		compositor_add(win_minimap, 1);
+	}
+	else if (!win_minimap_width && win_minimap)
+	{
+		compositor_remove(win_minimap);
+		delwin(win_minimap);
+		win_minimap = NULL;
+	}
+
+	set_offset_yx(win_board_height + 1, win_board_width + win_minimap_width, &offset_y, &offset_x);
+	offset_y++; // the score row
+	mvwin(win_board, offset_y, offset_x);
+	mvwin(win_score, offset_y - 1, offset_x - (win_score_width - win_board_width) / 2);
+
+	if (win_minimap)
+	{
+		mvwin(win_minimap, offset_y, offset_x + win_board_width);
+	}
+
+	erase();
+	compositor_damage(stdscr);
+}
+
+// The game's buffers, ahead of its first init when the caller has time
+// for it: startup prepares them once the splash screen is up. The
+// windows wait for the game, they'd show on top of the current screen.
+void screen_game_prepare(void)
+{
+	if (prepared)
+	{
+		return;
+	}
+
+	board_model			 = mem_calloc(sizeof(bool), BOARD_CELLS);
+	board_model_template = mem_calloc(sizeof(bool), BOARD_CELLS);
+	ASSERT(board_model && board_model_template);
+
+	// walls are the only closed cells of an empty board
+	for (uint8_t y = 1; y < BOARD_SIZE - 1; y++)
+	{
+		for (uint8_t x = 1; x < BOARD_SIZE - 1; x++)
+		{
+			open_rows_template[y * BOARD_ROW_WORDS + x / 64] |= (uint64_t)1 << (x % 64);
+		}
+	}
+
+	for (uint8_t x = BOARD_PADDING; x < BOARD_SIZE - BOARD_PADDING; x++)
+	{
+		spawn_columns[x / 64] |= (uint64_t)1 << (x % 64);
+	}
+
+	for (uint8_t i = 0; i < BOARD_SIZE; i++)
+	{
+		board_model_template[BOARD_INDEX(i, 0)]				 = true;
+		board_model_template[BOARD_INDEX(i, BOARD_SIZE - 1)] = true;
+		board_model_template[BOARD_INDEX(0, i)]				 = true;
+		board_model_template[BOARD_INDEX(BOARD_SIZE - 1, i)] = true;
+	}
+
+	snake.first_node = mem_calloc(sizeof(snake_node_t), BOARD_SIZE * BOARD_SIZE);
+	ASSERT(snake.first_node);
+
+	fruit_pool.fruits = mem_calloc(sizeof(fruit_t), fruit_pool_length);
+	ASSERT(fruit_pool.fruits);
+	fruit_pool.cells = sparse_map_new(BOARD_CELLS, sizeof(uint8_t));
+	sparse_map_reserve(&fruit_pool.cells, fruit_pool_length); // spawns never allocate
+	timers = timer_wheel_new(fruit_pool_length + 2);		  // fruits, the move and the spawn
+
+	board_cell_pool.free_cells			= bitset_new(BOARD_CELLS);
+	board_cell_pool_template.free_cells = bitset_new(BOARD_CELLS);
+
+	// fill available cells, avoiding board edges
+	for (uint8_t y = BOARD_PADDING; y < BOARD_SIZE - BOARD_PADDING; y++)
+	{
+		for (uint8_t x = BOARD_PADDING; x < BOARD_SIZE - BOARD_PADDING; x++)
+		{
+			bitset_set(&board_cell_pool_template.free_cells, BOARD_INDEX(x, y));
+		}
+	}
+
+	prepared = true;
+}
+
+static void handle_input(int key)
+{
+	snake_direction_t direction = snake.direction;
+
+	if (key > 0)
 	{
-		if (g_key == KEY_UP)
+		if (key == KEY_UP)
 		{
 			snake.direction = SNAKE_DIRECTION_TOP;
 			snake.tonge_ch	= CH_SNAKE_TONGE_TOP;
 		}
-		else if (g_key == KEY_DOWN)
+		else if (key == KEY_DOWN)
 		{
 			snake.direction = SNAKE_DIRECTION_BOTTOM;
 			snake.tonge_ch	= CH_SNAKE_TONGE_BOTTOM;
 		}
-		else if (g_key == KEY_LEFT)
+		else if (key == KEY_LEFT)
 		{
 			snake.direction = SNAKE_DIRECTION_LEFT;
 			snake.tonge_ch	= CH_SNAKE_TONGE_LEFT;
 		}
-		else if (g_key == KEY_RIGHT)
+		else if (key == KEY_RIGHT)
 		{
 			snake.direction = SNAKE_DIRECTION_RIGHT;
 			snake.tonge_ch	= CH_SNAKE_TONGE_RIGHT;
 		}
 	}
+
+	if (snake.direction != direction)
+	{
+		delta_put_status();
+	}
 }
 
 static void move_snake()
 {
+	net_buffer_put_u8(&delta, NET_OP_TAIL_REMOVE);
 	SET_BOARD_CELL_VAL(snake.tail->curr_pos.x, snake.tail->curr_pos.y, false);
 	snake.tail->prev_pos.x = snake.head->curr_pos.x;
 	snake.tail->prev_pos.y = snake.head->curr_pos.y;
@@ -319,154 +971,274 @@ static void move_snake()
 	{
 		snake.head->curr_pos.x += 1;
 	}
+
+	net_buffer_put_u8(&delta, NET_OP_HEAD_ADD);
+	net_buffer_put_u16(&delta, snake.head->curr_pos.x);
+	net_buffer_put_u16(&delta, snake.head->curr_pos.y);
+	TRACE2(move, snake.head->curr_pos.x, snake.head->curr_pos.y);
 }
 
-static void update_fruit_pool(void)
+// The spawn timer: the first idle slot gets a fruit on a free cell the
+// snake can reach, and the next spawn is set. Without either the spawn
+// waits, moves and expiring fruits try again.
+static void spawn_fruit(void)
 {
-	fruit_pool.elapsed_time += g_delta_time;
+	uint8_t	 i = 0;
+	uint32_t index;
 
-	for (uint8_t i = 0; i < fruit_pool.length; i++)
+	while (i < fruit_pool.length && fruit_pool.fruits[i].status != FRUIT_STATUS_IDLE)
 	{
-		fruit_t *fruit = &fruit_pool.fruits[i];
+		i++;
+	}
 
-		if (fruit->status == FRUIT_STATUS_ACTIVE)
-		{
-			fruit->elapsed_time += g_delta_time;
+	if (i == fruit_pool.length || (index = spawn_cell()) >= BOARD_CELLS)
+	{
+		fruit_pool.spawn_waiting = true;
+		return;
+	}
 
-			if (fruit->elapsed_time > fruit->lifetime)
-			{
-				fruit->status = FRUIT_STATUS_IDLE;
-				board_cell_pool_add(fruit->pos.x, fruit->pos.y);
-			}
-		}
-		else if (fruit->status == FRUIT_STATUS_IDLE && fruit_pool.elapsed_time > fruit_pool.rand_time_to_activate_fruit)
-		{
-			fruit->status			= FRUIT_STATUS_ACTIVE;
-			fruit->elapsed_time		= 0;
-			fruit->lifetime			= fruit_lifetime;
-			fruit_pool.elapsed_time = 0;
+	fruit_t *fruit			 = &fruit_pool.fruits[i];
+	fruit->status			 = FRUIT_STATUS_ACTIVE;
+	fruit->timer			 = timer_wheel_add(&timers, to_ticks(fruit_lifetime), GAME_TIMER_FRUIT + i);
+	fruit->pos.x			 = BOARD_INDEX_X(index);
+	fruit->pos.y			 = BOARD_INDEX_Y(index);
+	fruit_pool.spawn_waiting = false;
 
-			fruit_pool.rand_time_to_activate_fruit = 2 + rand() % 4; // between 2 and 4 seconds;
+	timer_wheel_add(&timers, to_ticks(fruit_spawn_delay_min + rand() % fruit_spawn_delay_range), GAME_TIMER_SPAWN);
 
-			// add the fruit in a free board cell
-			uint16_t available_cells_length = VECTOR_LENGTH(board_cell_pool.indexes.dense);
+	board_cell_pool_remove(fruit->pos.x, fruit->pos.y);
+	SPARSE_MAP_PUT(fruit_pool.cells, uint8_t, index, i);
+	delta_put_fruit(i);
+	TRACE3(fruit_spawn, i, fruit->pos.x, fruit->pos.y);
+}
 
-			if (available_cells_length)
-			{
-				uint16_t index = rand() % (available_cells_length - 1);
-				vec2_t	*cell  = (board_cell_pool.cells + index);
+// the lifetime timer of an active fruit, eating it cancels the timer
+static void expire_fruit(uint8_t slot)
+{
+	fruit_t *fruit = &fruit_pool.fruits[slot];
 
-				fruit->pos.x = cell->x;
-				fruit->pos.y = cell->y;
+	fruit->status = FRUIT_STATUS_IDLE;
+	board_cell_pool_add(fruit->pos.x, fruit->pos.y);
+	sparse_map_remove(&fruit_pool.cells, BOARD_INDEX(fruit->pos.x, fruit->pos.y));
+	delta_put_fruit(slot);
+	TRACE3(fruit_expire, slot, fruit->pos.x, fruit->pos.y);
 
-				board_cell_pool_remove(cell->x, cell->y);
-			}
-		}
+	if (fruit_pool.spawn_waiting)
+	{
+		spawn_fruit();
 	}
 }
 
 static void check_eaten_fruits(void)
 {
-	uint8_t head_x = snake.head->curr_pos.x * 2;
-	uint8_t head_y = snake.head->curr_pos.y;
-	uint8_t tail_x = snake.tail->prev_pos.x * 2;
-	uint8_t tail_y = snake.tail->prev_pos.y;
+	uint8_t *slot = SPARSE_MAP_GET(fruit_pool.cells, uint8_t, BOARD_INDEX(snake.head->curr_pos.x, snake.head->curr_pos.y));
 
-	for (uint8_t i = 0; i < fruit_pool.length; i++)
+	if (slot && fruit_pool.fruits[*slot].status == FRUIT_STATUS_ACTIVE)
 	{
-		fruit_t *fruit = &fruit_pool.fruits[i];
+		fruit_pool.fruits[*slot].status = FRUIT_STATUS_EATEN;
+		timer_wheel_cancel(&timers, fruit_pool.fruits[*slot].timer);
+		g_score.current += points_fruit_eaten;
+		delta_put_fruit(*slot);
+		TRACE3(fruit_eat, *slot, snake.head->curr_pos.x, snake.head->curr_pos.y);
 
-		if (fruit->status == FRUIT_STATUS_ACTIVE &&
-			(head_x == fruit->pos.x || (head_x + 1) == fruit->pos.x) &&
-			head_y == fruit->pos.y)
+		if (snake.speed > snake.max_speed)
 		{
-			fruit->status = FRUIT_STATUS_EATEN;
-			g_score.current += points_fruit_eaten;
-
-			if (snake.speed > snake.max_speed)
-			{
-				snake.speed -= snake.acceleration;
-			}
+			snake.speed -= snake.acceleration;
 		}
-		else if (fruit->status == FRUIT_STATUS_EATEN &&
-				 (tail_x == fruit->pos.x || (tail_x + 1) == fruit->pos.x) &&
-				 tail_y == fruit->pos.y)
-		{
-			snake_node_t *next_node = (snake.first_node + snake.length);
-			next_node->curr_pos.x	= snake.tail->prev_pos.x;
-			next_node->curr_pos.y	= snake.tail->prev_pos.y;
+	}
 
-			snake.tail->next_node = next_node;
-			next_node->prev_node  = snake.tail;
-			snake.tail			  = next_node;
-			snake.length++;
+	// an eaten fruit grows the snake once the tail leaves its cell
+	uint32_t tail_index = BOARD_INDEX(snake.tail->prev_pos.x, snake.tail->prev_pos.y);
+	slot				= SPARSE_MAP_GET(fruit_pool.cells, uint8_t, tail_index);
 
-			fruit->status = FRUIT_STATUS_IDLE;
-		}
+	if (slot && fruit_pool.fruits[*slot].status == FRUIT_STATUS_EATEN)
+	{
+		uint8_t		  i			= *slot;
+		snake_node_t *next_node = (snake.first_node + snake.length);
+		next_node->curr_pos.x	= snake.tail->prev_pos.x;
+		next_node->curr_pos.y	= snake.tail->prev_pos.y;
+		next_node->next_node	= NULL;
+
+		snake.tail->next_node = next_node;
+		next_node->prev_node  = snake.tail;
+		snake.tail			  = next_node;
+		snake.length++;
+		SET_BOARD_CELL_VAL(next_node->curr_pos.x, next_node->curr_pos.y, true);
+
+		fruit_pool.fruits[i].status = FRUIT_STATUS_IDLE;
+		sparse_map_remove(&fruit_pool.cells, tail_index);
+
+		net_buffer_put_u8(&delta, NET_OP_TAIL_ADD);
+		net_buffer_put_u16(&delta, next_node->curr_pos.x);
+		net_buffer_put_u16(&delta, next_node->curr_pos.y);
+		delta_put_fruit(i);
 	}
 }
 
 static void check_collision()
 {
-	uint8_t head_x = snake.head->curr_pos.x;
-	uint8_t head_y = snake.head->curr_pos.y;
+	snake.collided = GET_BOARD_CELL_VAL(snake.head->curr_pos.x, snake.head->curr_pos.y);
 
-	snake.collided = head_x <= 0 ||
-					 head_x >= (win_board_height - 1) ||
-					 head_y <= 0 ||
-					 head_y >= (win_board_height - 1) ||
-					 GET_BOARD_CELL_VAL(head_x, head_y);
+	if (snake.collided)
+	{
+		TRACE2(collision, snake.head->curr_pos.x, snake.head->curr_pos.y);
+	}
 }
 
-static void board_cell_pool_add(uint8_t x, uint8_t y)
+static void update_reach(void)
 {
-	if (x <= win_board_padding ||
-		y <= win_board_padding ||
-		x >= (win_board_height - win_board_padding) ||
-		y >= (win_board_height - win_board_padding))
+	vec2_t head = snake.head->curr_pos;
+
+	memset(reach_rows, 0, sizeof(reach_rows));
+	reach_rows[head.y * BOARD_ROW_WORDS + head.x / 64] = (uint64_t)1 << (head.x % 64);
+	reachable_cells = flood_fill(reach_rows, open_rows, BOARD_SIZE, BOARD_ROW_WORDS);
+
+	if (!snake.trapped && is_trapped())
 	{
-		return;
+		snake.trapped = true;
+		TRACE2(trapped, reachable_cells, snake.length);
 	}
+}
 
-	uint16_t index = COORDS_TO_INDEX(x, y);
-	sparse_set_add(&board_cell_pool.indexes, index);
-	uint16_t available_cells_length = VECTOR_LENGTH(board_cell_pool.indexes.dense);
-	vec2_t	*cell					= (board_cell_pool.cells + available_cells_length - 1);
+// The body segment i cells from the tail frees up when the (i + 1)-th
+// move starts. Shut in n cells, the head makes at most n moves before
+// it needs a way out, so the snake is doomed unless one of the last
+// n + 1 segments borders its region. Pending growth only delays the
+// tail, a trapped snake never gets out.
+static bool is_trapped(void)
+{
+	if (reachable_cells + 1 >= snake.length)
+	{
+		return false; // the segment behind the head borders the region
+	}
+
+	snake_node_t *node = snake.tail;
+
+	for (uint32_t i = 0; i <= reachable_cells; i++, node = node->prev_node)
+	{
+		if (borders_reach(node->curr_pos))
+		{
+			return false;
+		}
+	}
 
-	cell->x = x;
-	cell->y = y;
+	return true;
 }
 
-static void board_cell_pool_remove(uint8_t x, uint8_t y)
+static bool borders_reach(vec2_t pos)
 {
-	if (x <= win_board_padding ||
-		y <= win_board_padding ||
-		x >= (win_board_height - win_board_padding) ||
-		y >= (win_board_height - win_board_padding))
+	static const int8_t offsets[][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+
+	for (uint8_t i = 0; i < 4; i++)
 	{
-		return;
+		uint8_t x = pos.x + offsets[i][0];
+		uint8_t y = pos.y + offsets[i][1];
+
+		// body cells are never on the walls, neighbours are on the board
+		if (reach_rows[y * BOARD_ROW_WORDS + x / 64] >> (x % 64) & 1)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// a random free cell the head can reach, BOARD_CELLS when there's none
+static uint32_t spawn_cell(void)
+{
+	// a single region: every free cell qualifies, pick one by rank
+	if (reachable_cells == open_cells)
+	{
+		uint32_t count = board_cell_pool.free_cells.count;
+		return count ? bitset_select(&board_cell_pool.free_cells, rand() % count) : BOARD_CELLS;
+	}
+
+	// the body splits the board: pick among the free cells of the head's region
+	uint32_t count = 0;
+
+	for (uint8_t y = BOARD_PADDING; y < BOARD_SIZE - BOARD_PADDING; y++)
+	{
+		for (uint8_t w = 0; w < BOARD_ROW_WORDS; w++)
+		{
+			count += __builtin_popcountll(spawn_candidates(y, w));
+		}
+	}
+
+	if (!count)
+	{
+		return BOARD_CELLS;
+	}
+
+	uint32_t k = rand() % count;
+
+	for (uint8_t y = BOARD_PADDING; y < BOARD_SIZE - BOARD_PADDING; y++)
+	{
+		for (uint8_t w = 0; w < BOARD_ROW_WORDS; w++)
+		{
+			uint64_t candidates = spawn_candidates(y, w);
+			uint32_t length		= __builtin_popcountll(candidates);
+
+			if (k >= length)
+			{
+				k -= length;
+				continue;
+			}
+
+			for (; k; k--)
+			{
+				candidates &= candidates - 1;
+			}
+
+			return BOARD_INDEX(w * 64 + __builtin_ctzll(candidates), y);
+		}
+	}
+
+	return BOARD_CELLS;
+}
+
+// free cells of a row word in the spawn area and the head's region,
+// active fruits are open but taken
+static uint64_t spawn_candidates(uint8_t y, uint8_t word)
+{
+	uint64_t candidates = reach_rows[y * BOARD_ROW_WORDS + word] & open_rows[y * BOARD_ROW_WORDS + word] & spawn_columns[word];
+
+	for (uint8_t i = 0; i < fruit_pool.length; i++)
+	{
+		const fruit_t *fruit = &fruit_pool.fruits[i];
+
+		if (fruit->status == FRUIT_STATUS_ACTIVE && fruit->pos.y == y && fruit->pos.x / 64 == word)
+		{
+			candidates &= ~((uint64_t)1 << (fruit->pos.x % 64));
+		}
 	}
 
-	int32_t coord_index = COORDS_TO_INDEX(x, y);
-	int16_t index		= SPARSE_SET_INDEXOF(board_cell_pool.indexes, coord_index);
+	return candidates;
+}
 
-	if (index < 0)
+static void board_cell_pool_add(uint8_t x, uint8_t y)
+{
+	if (!BOARD_IN_SPAWN_AREA(x, y))
 	{
 		return;
 	}
 
-	uint16_t available_cells_length = VECTOR_LENGTH(board_cell_pool.indexes.dense);
-	vec2_t	*cell_origin			= (board_cell_pool.cells + available_cells_length - 1);
-	vec2_t	*cell_dest				= (board_cell_pool.cells + index);
+	bitset_set(&board_cell_pool.free_cells, BOARD_INDEX(x, y));
+}
+
+static void board_cell_pool_remove(uint8_t x, uint8_t y)
+{
+	if (!BOARD_IN_SPAWN_AREA(x, y))
+	{
+		return;
+	}
 
-	cell_dest->x = cell_origin->x;
-	cell_dest->y = cell_origin->y;
-	sparse_set_remove(&board_cell_pool.indexes, coord_index);
+	bitset_clear(&board_cell_pool.free_cells, BOARD_INDEX(x, y));
 }
 
 static void save_score(void)
 {
-	if (g_score.current <= g_score.record)
+	if (g_options.headless || g_score.current <= g_score.record)
 	{
 		return;
 	}
@@ -480,62 +1252,188 @@ static void save_score(void)
 	fclose(f);
 }
 
+static void delta_put_fruit(uint8_t slot)
+{
+	fruit_t *fruit = &fruit_pool.fruits[slot];
+
+	net_buffer_put_u8(&delta, NET_OP_FRUIT);
+	net_buffer_put_u8(&delta, slot);
+	net_buffer_put_u8(&delta, fruit->status);
+	net_buffer_put_u16(&delta, fruit->pos.x);
+	net_buffer_put_u16(&delta, fruit->pos.y);
+}
+
+static void delta_put_status(void)
+{
+	net_buffer_put_u8(&delta, NET_OP_STATUS);
+	net_buffer_put_u8(&delta, snake.direction);
+	net_buffer_put_u8(&delta, snake.collided);
+}
+
+static void write_keyframe(net_buffer_t *buffer)
+{
+	net_buffer_put_u16(buffer, BOARD_SIZE);
+	net_buffer_put_u32(buffer, g_score.current);
+	net_buffer_put_u32(buffer, g_score.record);
+	net_buffer_put_u8(buffer, snake.direction);
+	net_buffer_put_u8(buffer, snake.collided);
+	net_buffer_put_u16(buffer, snake.length);
+
+	for (snake_node_t *node = snake.head; node; node = node->next_node)
+	{
+		net_buffer_put_u16(buffer, node->curr_pos.x);
+		net_buffer_put_u16(buffer, node->curr_pos.y);
+	}
+
+	net_buffer_put_u8(buffer, fruit_pool.length);
+
+	for (uint8_t i = 0; i < fruit_pool.length; i++)
+	{
+		net_buffer_put_u8(buffer, fruit_pool.fruits[i].status);
+		net_buffer_put_u16(buffer, fruit_pool.fruits[i].pos.x);
+		net_buffer_put_u16(buffer, fruit_pool.fruits[i].pos.y);
+	}
+}
+
+// walls are drawn where the board edges fall inside the view, the same
+// as a box around the window when the whole board is shown
 static void render_board(void)
 {
-	wattron(win_board, COLOR_PAIR(COLOR_PAIR_GREEN));
-	box(win_board, 0, 0);
-	wattroff(win_board, COLOR_PAIR(COLOR_PAIR_GREEN));
+	bool	lb	   = g_options.low_bandwidth;
+	int16_t bottom = BOARD_SIZE - 1 - snapshot->camera.y;
+	int16_t right  = (BOARD_SIZE - 1 - snapshot->camera.x) * cell_width + cell_width - 1;
+	bool	top_in = !snapshot->camera.y, left_in = !snapshot->camera.x;
+	bool	bottom_in = bottom < win_board_height, right_in = right < win_board_width;
+
+	if (!lb)
+	{
+		wattron(win_board, COLOR_PAIR(COLOR_PAIR_GREEN));
+	}
+
+	if (top_in)
+	{
+		mvwhline(win_board, 0, 0, lb ? '-' : ACS_HLINE, win_board_width);
+	}
+	if (bottom_in)
+	{
+		mvwhline(win_board, bottom, 0, lb ? '-' : ACS_HLINE, win_board_width);
+	}
+	if (left_in)
+	{
+		mvwvline(win_board, 0, 0, lb ? '|' : ACS_VLINE, win_board_height);
+	}
+	if (right_in)
+	{
+		mvwvline(win_board, 0, right, lb ? '|' : ACS_VLINE, win_board_height);
+	}
+
+	if (top_in && left_in)
+	{
+		mvwaddch(win_board, 0, 0, lb ? '+' : ACS_ULCORNER);
+	}
+	if (top_in && right_in)
+	{
+		mvwaddch(win_board, 0, right, lb ? '+' : ACS_URCORNER);
+	}
+	if (bottom_in && left_in)
+	{
+		mvwaddch(win_board, bottom, 0, lb ? '+' : ACS_LLCORNER);
+	}
+	if (bottom_in && right_in)
+	{
+		mvwaddch(win_board, bottom, right, lb ? '+' : ACS_LRCORNER);
+	}
+
+	if (!lb)
+	{
+		wattroff(win_board, COLOR_PAIR(COLOR_PAIR_GREEN));
+	}
+}
+
+// draws the snake cells under the camera (walls excluded) and the head,
+// which may be on a wall after a collision
+static void render_snake_cells(chtype body_ch, chtype head_ch)
+{
+	int16_t head_y = snapshot->head.y - snapshot->camera.y;
+	int16_t head_x = (snapshot->head.x - snapshot->camera.x) * cell_width;
+
+	for (uint16_t row = 0; row < snapshot->view_rows; row++)
+	{
+		const bool *cells = &snapshot->cells[row * snapshot->view_cols];
+		uint8_t		y	  = snapshot->camera.y + row;
+
+		if (y == 0 || y == BOARD_SIZE - 1)
+		{
+			continue;
+		}
+
+		for (uint16_t col = 0; col < snapshot->view_cols; col++)
+		{
+			uint8_t x = snapshot->camera.x + col;
+
+			if (cells[col] && x != 0 && x != BOARD_SIZE - 1)
+			{
+				mvwhline(win_board, row, col * cell_width, body_ch, cell_width);
+			}
+		}
+	}
+
+	mvwhline(win_board, head_y, head_x, head_ch, cell_width);
 }
 
 static void render_snake(void)
 {
-	snake_node_t *node_aux = snake.head;
+	// plain ASCII in a single attribute: the terminal gets no color or
+	// charset switches, and the head glyph replaces the tongue
+	if (g_options.low_bandwidth)
+	{
+		render_snake_cells(snapshot->collided ? 'x' : '#', head_glyphs[snapshot->direction]);
+		return;
+	}
+
+	int16_t head_y = snapshot->head.y - snapshot->camera.y;
+	int16_t head_x = (snapshot->head.x - snapshot->camera.x) * cell_width;
 
 	wattron(win_board, COLOR_PAIR(COLOR_PAIR_RED));
 
-	// tonge
-	if (snake.direction == SNAKE_DIRECTION_TOP)
+	// tonge, curses ignores it out of the view
+	if (snapshot->direction == SNAKE_DIRECTION_TOP)
 	{
-		mvwaddch(win_board, node_aux->curr_pos.y - 1, node_aux->curr_pos.x * 2 + 1, snake.tonge_ch);
+		mvwaddch(win_board, head_y - 1, head_x + cell_width - 1, snapshot->tonge_ch);
 	}
-	else if (snake.direction == SNAKE_DIRECTION_BOTTOM)
+	else if (snapshot->direction == SNAKE_DIRECTION_BOTTOM)
 	{
-		mvwaddch(win_board, node_aux->curr_pos.y + 1, node_aux->curr_pos.x * 2, snake.tonge_ch);
+		mvwaddch(win_board, head_y + 1, head_x, snapshot->tonge_ch);
 	}
-	else if (snake.direction == SNAKE_DIRECTION_LEFT || snake.direction == SNAKE_DIRECTION_IDLE)
+	else if (snapshot->direction == SNAKE_DIRECTION_LEFT || snapshot->direction == SNAKE_DIRECTION_IDLE)
 	{
-		mvwaddch(win_board, node_aux->curr_pos.y, node_aux->curr_pos.x * 2 - 1, snake.tonge_ch);
+		mvwaddch(win_board, head_y, head_x - 1, snapshot->tonge_ch);
 	}
-	else if (snake.direction == SNAKE_DIRECTION_RIGHT)
+	else if (snapshot->direction == SNAKE_DIRECTION_RIGHT)
 	{
-		mvwaddch(win_board, node_aux->curr_pos.y, node_aux->curr_pos.x * 2 + 2, snake.tonge_ch);
+		mvwaddch(win_board, head_y, head_x + cell_width, snapshot->tonge_ch);
 	}
 
 	wattroff(win_board, COLOR_PAIR(COLOR_PAIR_RED));
 
-	uint8_t snake_color = snake.collided && (uint32_t)(snake.collided_elapsed_time * 5) % 2 ? COLOR_PAIR_RED : COLOR_PAIR_GREEN;
+	uint8_t snake_color = snapshot->collided && snapshot->blink ? COLOR_PAIR_RED : COLOR_PAIR_GREEN;
 	wattron(win_board, COLOR_PAIR(snake_color));
-
-	// body
-	while (node_aux)
-	{
-		mvwaddch(win_board, node_aux->curr_pos.y, node_aux->curr_pos.x * 2, CH_SHAPE_FILL);
-		mvwaddch(win_board, node_aux->curr_pos.y, (node_aux->curr_pos.x * 2) + 1, CH_SHAPE_FILL);
-		node_aux = node_aux->next_node;
-	}
-
+	render_snake_cells(CH_SHAPE_FILL, CH_SHAPE_FILL);
 	wattroff(win_board, COLOR_PAIR(snake_color));
 }
 
 static void render_fruits(void)
 {
-	for (uint8_t i = 0; i < fruit_pool.length; i++)
+	chtype fruit_ch = g_options.low_bandwidth ? '*' : ACS_DIAMOND;
+
+	for (uint8_t i = 0; i < snapshot->fruits_length; i++)
 	{
-		fruit_t fruit = fruit_pool.fruits[i];
+		int16_t y = snapshot->fruits[i].y - snapshot->camera.y;
+		int16_t x = snapshot->fruits[i].x - snapshot->camera.x;
 
-		if (fruit.status == FRUIT_STATUS_ACTIVE)
+		if (y >= 0 && y < snapshot->view_rows && x >= 0 && x < snapshot->view_cols)
 		{
-			mvwaddch(win_board, fruit.pos.y, fruit.pos.x, ACS_DIAMOND);
+			mvwaddch(win_board, y, x * cell_width, fruit_ch);
 		}
 	}
 }
@@ -545,13 +1443,74 @@ static void render_score(void)
 	char max_score[20]	   = { '\0' };
 	char current_score[20] = { '\0' };
 
-	sprintf(max_score, "Max score: %d", g_score.record);
-	sprintf(current_score, "Current score: %d", g_score.current);
-	uint8_t x = win_score_width - strlen(current_score);
+	sprintf(max_score, "Max score: %d", snapshot->score.record);
+
+	// no way out: told before the head hits the body
+	if (snapshot->trapped && !snapshot->collided)
+	{
+		sprintf(max_score, "TRAPPED!");
+	}
+	sprintf(current_score, "Current score: %d", snapshot->score.current);
+	uint16_t x = win_score_width - strlen(current_score);
 
 	werase(win_score);
 	mvwprintw(win_score, 0, 1, "%s", max_score);
 	mvwprintw(win_score, 0, x - 1, "%s", current_score);
 
-	wrefresh(win_score);
+	compositor_damage(win_score);
+}
+
+// one character per block: shaded by the snake cells in it, fruits and
+// the head on top, and the blocks under the camera highlighted
+static void render_minimap(void)
+{
+	static const chtype shades[] = { ' ', '.', ':', '#' };
+	bool				lb		 = g_options.low_bandwidth;
+	uint8_t				top		 = snapshot->camera.y >> MINIMAP_BLOCK_SHIFT;
+	uint8_t				left	 = snapshot->camera.x >> MINIMAP_BLOCK_SHIFT;
+	uint8_t				bottom	 = (snapshot->camera.y + snapshot->view_rows - 1) >> MINIMAP_BLOCK_SHIFT;
+	uint8_t				right	 = (snapshot->camera.x + snapshot->view_cols - 1) >> MINIMAP_BLOCK_SHIFT;
+
+	werase(win_minimap);
+
+	if (lb)
+	{
+		wborder(win_minimap, '|', '|', '-', '-', '+', '+', '+', '+');
+	}
+	else
+	{
+		wattron(win_minimap, COLOR_PAIR(COLOR_PAIR_GREEN));
+		box(win_minimap, 0, 0);
+		wattroff(win_minimap, COLOR_PAIR(COLOR_PAIR_GREEN));
+	}
+
+	for (uint8_t y = 0; y < MINIMAP_SIZE; y++)
+	{
+		for (uint8_t x = 0; x < MINIMAP_SIZE; x++)
+		{
+			uint16_t count = snapshot->blocks[y * MINIMAP_SIZE + x];
+			chtype	 ch	   = shades[count ? 1 + count * 2 / MINIMAP_BLOCK_CELLS : 0];
+
+			// plain ASCII has no highlight, the view is left out
+			if (!lb && y >= top && y <= bottom && x >= left && x <= right)
+			{
+				ch |= A_REVERSE;
+			}
+
+			mvwhline(win_minimap, y + 1, x * cell_width + 1, ch, cell_width);
+		}
+	}
+
+	for (uint8_t i = 0; i < snapshot->fruits_length; i++)
+	{
+		uint8_t y = snapshot->fruits[i].y >> MINIMAP_BLOCK_SHIFT;
+		uint8_t x = snapshot->fruits[i].x >> MINIMAP_BLOCK_SHIFT;
+		mvwaddch(win_minimap, y + 1, x * cell_width + 1, '*' | (mvwinch(win_minimap, y + 1, x * cell_width + 1) & A_REVERSE));
+	}
+
+	uint8_t head_y = snapshot->head.y >> MINIMAP_BLOCK_SHIFT;
+	uint8_t head_x = snapshot->head.x >> MINIMAP_BLOCK_SHIFT;
+	mvwaddch(win_minimap, head_y + 1, head_x * cell_width + 1, '@');
+
+	compositor_damage_cosmetic(win_minimap);
 }
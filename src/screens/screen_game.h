@@ -3,8 +3,10 @@
 
 #include "../defs.h"
 
+void screen_game_prepare(void);
 void screen_game_init(void);
 void screen_game_dispose(void);
+void screen_game_release(void);
 bool screen_game_is_completed(void);
 void screen_game_update(void);
 void screen_game_render(void);
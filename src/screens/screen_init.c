@@ -1,5 +1,6 @@
 #include "screen_init.h"
 #include "../common.h"
+#include "../compositor.h"
 
 extern char		*g_asset_splash;
 extern int		 g_key;
@@ -23,27 +24,31 @@ static void render_splash(void);
 
 void screen_init_init(void)
 {
-	uint8_t offset_y, offset_y2, offset_x;
+	uint16_t offset_y, offset_y2, offset_x;
 
 	set_offset_yx(win_splash_height, win_splash_width, &offset_y, &offset_x);
 	win_splash = newwin(win_splash_height, win_splash_width, offset_y, offset_x);
 	scrollok(win_splash, TRUE);
+	compositor_add(win_splash, 1);
 
 	set_offset_yx(win_actions_height, win_actions_width, &offset_y2, &offset_x);
 	win_actions = newwin(win_actions_height, win_actions_width, offset_y + win_splash_height, offset_x);
 	scrollok(win_actions, TRUE);
+	compositor_add(win_actions, 1);
 
 	render_splash();
 }
 
 void screen_init_dispose(void)
 {
-	wclear(win_splash);
-	wrefresh(win_splash);
+	werase(win_splash);
+	compositor_damage(win_splash);
+	compositor_remove(win_splash);
 	delwin(win_splash);
 
-	wclear(win_actions);
-	wrefresh(win_actions);
+	werase(win_actions);
+	compositor_damage(win_actions);
+	compositor_remove(win_actions);
 	delwin(win_actions);
 }
 
@@ -68,7 +73,7 @@ void screen_init_render(void)
 		mvwprintw(win_actions, 0, 0, "%s", label_start);
 	}
 
-	wrefresh(win_actions);
+	compositor_damage_cosmetic(win_actions);
 }
 
 void screen_init_window_resized(void)
@@ -105,5 +110,5 @@ static void render_splash(void)
 	}
 
 	wattroff(win_splash, COLOR_PAIR(COLOR_PAIR_RED));
-	wrefresh(win_splash);
+	compositor_damage(win_splash);
 }
\ No newline at end of file
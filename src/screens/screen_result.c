@@ -1,5 +1,6 @@
 #include "screen_result.h"
 #include "../common.h"
+#include "../compositor.h"
 
 extern int		 g_key;
 extern float32_t g_delta_time;
@@ -18,9 +19,10 @@ static const uint8_t   game_over_char_height	 = 4;
 static const uint8_t   game_over_length			 = 9;
 static const float32_t game_over_animation_speed = 6;
 
-static WINDOW *win_game_over;
-static WINDOW *win_new_record;
-static WINDOW *win_play_again;
+// windows are created once and reused by every game over
+static WINDOW *win_game_over  = NULL;
+static WINDOW *win_new_record = NULL;
+static WINDOW *win_play_again = NULL;
 
 static bool		 key_enter_pressed			= false;
 static bool		 render_play_again_label	= true;
@@ -39,17 +41,31 @@ static void render_play_again(void);
 
 void screen_result_init(void)
 {
-	uint8_t offset_y, offset_x;
+	uint16_t offset_y, offset_x;
 
 	set_offset_yx(win_game_over_height + win_new_record_height + win_play_again_height, win_game_over_width, &offset_y, &offset_x);
-	win_game_over = newwin(win_game_over_height, win_game_over_width, offset_y, offset_x);
-	scrollok(win_game_over, TRUE);
 
-	win_new_record = newwin(win_new_record_height, win_new_record_width, offset_y + win_game_over_height, offset_x);
-	scrollok(win_new_record, TRUE);
+	if (!win_game_over)
+	{
+		win_game_over = newwin(win_game_over_height, win_game_over_width, offset_y, offset_x);
+		scrollok(win_game_over, TRUE);
+
+		win_new_record = newwin(win_new_record_height, win_new_record_width, offset_y + win_game_over_height, offset_x);
+		scrollok(win_new_record, TRUE);
+
+		win_play_again = newwin(win_play_again_height, win_play_again_width, offset_y + win_game_over_height + win_new_record_height, offset_x);
+		scrollok(win_play_again, TRUE);
 
-	win_play_again = newwin(win_play_again_height, win_play_again_width, offset_y + win_game_over_height + win_new_record_height, offset_x);
-	scrollok(win_play_again, TRUE);
+		compositor_add(win_game_over, 1);
+		compositor_add(win_new_record, 1);
+		compositor_add(win_play_again, 1);
+	}
+	else
+	{
+		mvwin(win_game_over, offset_y, offset_x);
+		mvwin(win_new_record, offset_y + win_game_over_height, offset_x);
+		mvwin(win_play_again, offset_y + win_game_over_height + win_new_record_height, offset_x);
+	}
 
 	key_enter_pressed				 = false;
 	elapsed_time					 = 0;
@@ -62,17 +78,30 @@ void screen_result_init(void)
 
 void screen_result_dispose(void)
 {
-	wclear(win_game_over);
-	wrefresh(win_game_over);
-	delwin(win_game_over);
+	werase(win_game_over);
+	compositor_damage(win_game_over);
 
-	wclear(win_new_record);
-	wrefresh(win_new_record);
-	delwin(win_new_record);
+	werase(win_new_record);
+	compositor_damage(win_new_record);
 
-	wclear(win_play_again);
-	wrefresh(win_play_again);
+	werase(win_play_again);
+	compositor_damage(win_play_again);
+}
+
+void screen_result_release(void)
+{
+	if (!win_game_over)
+	{
+		return;
+	}
+
+	compositor_remove(win_game_over);
+	compositor_remove(win_new_record);
+	compositor_remove(win_play_again);
+	delwin(win_game_over);
+	delwin(win_new_record);
 	delwin(win_play_again);
+	win_game_over = win_new_record = win_play_again = NULL;
 }
 
 bool screen_result_is_completed(void)
@@ -155,16 +184,14 @@ static void render_game_over(void)
 	}
 
 	wattroff(win_game_over, COLOR_PAIR(COLOR_PAIR_RED));
-	wrefresh(win_game_over);
-
-	wrefresh(win_game_over);
+	compositor_damage_cosmetic(win_game_over);
 }
 
 static void render_new_record(void)
 {
 	uint8_t offset_x;
 	char	record[30] = { '\0' };
-	wclear(win_new_record);
+	werase(win_new_record);
 
 	sprintf(record, "New record! %d", (uint32_t)record_points);
 	offset_x = (win_new_record_width - 12) * 0.5;
@@ -173,7 +200,7 @@ static void render_new_record(void)
 	mvwprintw(win_new_record, 1, offset_x, "%s", record);
 	wattroff(win_new_record, COLOR_PAIR(COLOR_PAIR_GREEN));
 
-	wrefresh(win_new_record);
+	compositor_damage_cosmetic(win_new_record);
 }
 
 static void render_play_again(void)
@@ -187,5 +214,5 @@ static void render_play_again(void)
 		mvwprintw(win_play_again, 2, offset_x, "Press enter to play again");
 	}
 
-	wrefresh(win_play_again);
+	compositor_damage_cosmetic(win_play_again);
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 
 void screen_result_init(void);
 void screen_result_dispose(void);
+void screen_result_release(void);
 bool screen_result_is_completed(void);
 void screen_result_update(void);
 void screen_result_render(void);
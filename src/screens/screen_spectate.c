@@ -0,0 +1,417 @@
+#define _POSIX_C_SOURCE 200809L
+#include "screen_spectate.h"
+#include "../common.h"
+#include "../compositor.h"
+#include "../mem.h"
+#include "../net/protocol.h"
+
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+extern options_t g_options;
+extern float32_t g_delta_time;
+
+#define SPECTATE_RECV_SIZE (NET_FRAME_HEADER_SIZE + NET_KEYFRAME_MAX_SIZE + 64 * 1024)
+#define SPECTATE_MAX_FRUITS 256
+
+// Client side mirror of the game server state.
+// The snake is kept as a ring buffer of cells, head first, so
+// head/tail ops from a delta frame are O(1).
+typedef struct mirror_t
+{
+	vec2_t	*segments;
+	uint32_t capacity;
+	uint32_t first; // head index in 'segments'
+	uint32_t length;
+	uint16_t board_size;
+	uint32_t score;
+	uint32_t record;
+	uint8_t	 direction;
+	bool	 collided;
+	struct
+	{
+		uint8_t status;
+		vec2_t	pos;
+	} fruits[SPECTATE_MAX_FRUITS];
+	uint8_t fruits_length;
+} mirror_t;
+
+static const char *label_waiting	   = "Waiting for the game server...";
+static const char *label_disconnected = "Connection lost, press ESC to exit";
+static const char *label_too_large	   = "The board doesn't fit the terminal, enlarge it or press ESC";
+
+static WINDOW	*win_board	  = NULL;
+static WINDOW	*win_score	  = NULL;
+static int		 socket_fd	  = -1;
+static bool		 synced		  = false;
+static float32_t flash_elapsed = 0;
+static mirror_t	 mirror;
+static uint8_t	 recv_data[SPECTATE_RECV_SIZE];
+static uint32_t	 recv_length = 0;
+
+static void connect_server(void);
+static void receive_frames(void);
+static void apply_keyframe(net_reader_t *reader);
+static void apply_delta(net_reader_t *reader);
+static void mirror_push_head(vec2_t pos);
+static void mirror_push_tail(vec2_t pos);
+static void create_windows(void);
+static void render_message(const char *message);
+
+void screen_spectate_init(void)
+{
+	memset(&mirror, 0, sizeof(mirror));
+	connect_server();
+	render_message(label_waiting);
+}
+
+void screen_spectate_dispose(void)
+{
+#ifdef __linux__
+	if (socket_fd >= 0)
+	{
+		close(socket_fd);
+		socket_fd = -1;
+	}
+#endif
+
+	if (win_board)
+	{
+		compositor_remove(win_board);
+		compositor_remove(win_score);
+		delwin(win_board);
+		delwin(win_score);
+		win_board = win_score = NULL;
+	}
+
+	mem_free(mirror.segments);
+	mirror.segments = NULL;
+}
+
+bool screen_spectate_is_completed(void)
+{
+	// stays on screen until the user quits
+	return false;
+}
+
+void screen_spectate_update(void)
+{
+	receive_frames();
+	flash_elapsed = mirror.collided ? flash_elapsed + g_delta_time : 0;
+}
+
+void screen_spectate_render(void)
+{
+	if (socket_fd < 0)
+	{
+		render_message(label_disconnected);
+		return;
+	}
+
+	if (!synced)
+	{
+		return;
+	}
+
+	if (!win_board)
+	{
+		render_message(label_too_large);
+		return;
+	}
+
+	char max_score[20]	   = { '\0' };
+	char current_score[20] = { '\0' };
+	sprintf(max_score, "Max score: %d", mirror.record);
+	sprintf(current_score, "Current score: %d", mirror.score);
+
+	werase(win_score);
+	mvwprintw(win_score, 0, 1, "%s", max_score);
+	mvwprintw(win_score, 0, getmaxx(win_score) - strlen(current_score) - 1, "%s", current_score);
+	compositor_damage(win_score);
+
+	werase(win_board);
+	wattron(win_board, COLOR_PAIR(COLOR_PAIR_GREEN));
+	box(win_board, 0, 0);
+	wattroff(win_board, COLOR_PAIR(COLOR_PAIR_GREEN));
+
+	for (uint8_t i = 0; i < mirror.fruits_length; i++)
+	{
+		if (mirror.fruits[i].status == 1) // FRUIT_STATUS_ACTIVE
+		{
+			mvwaddch(win_board, mirror.fruits[i].pos.y, mirror.fruits[i].pos.x * 2, ACS_DIAMOND);
+		}
+	}
+
+	uint8_t snake_color = mirror.collided && (uint32_t)(flash_elapsed * 5) % 2 ? COLOR_PAIR_RED : COLOR_PAIR_GREEN;
+	wattron(win_board, COLOR_PAIR(snake_color));
+
+	for (uint32_t i = 0; i < mirror.length; i++)
+	{
+		vec2_t pos = mirror.segments[(mirror.first + i) % mirror.capacity];
+		mvwaddch(win_board, pos.y, pos.x * 2, CH_SHAPE_FILL);
+		mvwaddch(win_board, pos.y, pos.x * 2 + 1, CH_SHAPE_FILL);
+	}
+
+	wattroff(win_board, COLOR_PAIR(snake_color));
+	compositor_damage(win_board);
+}
+
+void screen_spectate_window_resized(void)
+{
+	if (mirror.board_size)
+	{
+		erase();
+		compositor_damage(stdscr);
+		create_windows();
+	}
+}
+
+#ifdef __linux__
+
+static void connect_server(void)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+	if (!g_options.spectate_path || strlen(g_options.spectate_path) >= sizeof(addr.sun_path))
+	{
+		return;
+	}
+
+	strcpy(addr.sun_path, g_options.spectate_path);
+	socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if (socket_fd >= 0 && connect(socket_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+	{
+		close(socket_fd);
+		socket_fd = -1;
+	}
+
+	if (socket_fd >= 0)
+	{
+		fcntl(socket_fd, F_SETFL, fcntl(socket_fd, F_GETFL) | O_NONBLOCK);
+	}
+}
+
+static void receive_frames(void)
+{
+	if (socket_fd < 0)
+	{
+		return;
+	}
+
+	ssize_t received;
+
+	while ((received = recv(socket_fd, recv_data + recv_length, SPECTATE_RECV_SIZE - recv_length, 0)) > 0)
+	{
+		recv_length += received;
+
+		uint32_t offset = 0;
+
+		while (recv_length - offset >= NET_FRAME_HEADER_SIZE)
+		{
+			net_frame_header_t header;
+			memcpy(&header, recv_data + offset, NET_FRAME_HEADER_SIZE);
+			ASSERT(NET_FRAME_HEADER_SIZE + header.length <= SPECTATE_RECV_SIZE);
+
+			if (recv_length - offset < NET_FRAME_HEADER_SIZE + header.length)
+			{
+				break;
+			}
+
+			net_reader_t reader = { .data = recv_data + offset + NET_FRAME_HEADER_SIZE, .length = header.length };
+
+			if (header.type == NET_FRAME_KEYFRAME)
+			{
+				apply_keyframe(&reader);
+			}
+			else if (header.type == NET_FRAME_DELTA && synced)
+			{
+				apply_delta(&reader);
+			}
+
+			offset += NET_FRAME_HEADER_SIZE + header.length;
+		}
+
+		memmove(recv_data, recv_data + offset, recv_length - offset);
+		recv_length -= offset;
+	}
+
+	if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+	{
+		close(socket_fd);
+		socket_fd = -1;
+	}
+}
+
+#else
+
+static void connect_server(void)
+{
+}
+
+static void receive_frames(void)
+{
+}
+
+#endif
+
+static void apply_keyframe(net_reader_t *reader)
+{
+	uint16_t board_size = net_reader_get_u16(reader);
+	mirror.score		= net_reader_get_u32(reader);
+	mirror.record		= net_reader_get_u32(reader);
+	mirror.direction	= net_reader_get_u8(reader);
+	mirror.collided		= net_reader_get_u8(reader);
+
+	if (board_size != mirror.board_size)
+	{
+		mirror.board_size = board_size;
+		mirror.capacity	  = board_size * board_size;
+		mem_free(mirror.segments);
+		mirror.segments = mem_calloc(mirror.capacity, sizeof(vec2_t));
+		ASSERT(mirror.segments);
+
+		erase();
+		compositor_damage(stdscr);
+		create_windows();
+	}
+
+	uint16_t snake_length = net_reader_get_u16(reader);
+	mirror.first		  = 0;
+	mirror.length		  = 0;
+
+	for (uint16_t i = 0; i < snake_length; i++)
+	{
+		vec2_t pos;
+		pos.x = net_reader_get_u16(reader);
+		pos.y = net_reader_get_u16(reader);
+		mirror_push_tail(pos);
+	}
+
+	mirror.fruits_length = net_reader_get_u8(reader);
+
+	for (uint8_t i = 0; i < mirror.fruits_length; i++)
+	{
+		mirror.fruits[i].status = net_reader_get_u8(reader);
+		mirror.fruits[i].pos.x	= net_reader_get_u16(reader);
+		mirror.fruits[i].pos.y	= net_reader_get_u16(reader);
+	}
+
+	synced = !reader->overflow;
+}
+
+static void apply_delta(net_reader_t *reader)
+{
+	while (reader->offset < reader->length && !reader->overflow)
+	{
+		uint8_t op = net_reader_get_u8(reader);
+		vec2_t	pos;
+
+		switch ((net_op_t)op)
+		{
+		case NET_OP_HEAD_ADD:
+			pos.x = net_reader_get_u16(reader);
+			pos.y = net_reader_get_u16(reader);
+			mirror_push_head(pos);
+			break;
+		case NET_OP_TAIL_REMOVE:
+			mirror.length -= mirror.length ? 1 : 0;
+			break;
+		case NET_OP_TAIL_ADD:
+			pos.x = net_reader_get_u16(reader);
+			pos.y = net_reader_get_u16(reader);
+			mirror_push_tail(pos);
+			break;
+		case NET_OP_FRUIT:
+		{
+			uint8_t slot = net_reader_get_u8(reader);
+
+			mirror.fruits[slot].status = net_reader_get_u8(reader);
+			mirror.fruits[slot].pos.x  = net_reader_get_u16(reader);
+			mirror.fruits[slot].pos.y  = net_reader_get_u16(reader);
+			break;
+		}
+		case NET_OP_SCORE:
+			mirror.score  = net_reader_get_u32(reader);
+			mirror.record = net_reader_get_u32(reader);
+			break;
+		case NET_OP_STATUS:
+			mirror.direction = net_reader_get_u8(reader);
+			mirror.collided	 = net_reader_get_u8(reader);
+			break;
+		default:
+			// unknown op, wait for the next keyframe
+			synced = false;
+			return;
+		}
+	}
+
+	synced = !reader->overflow;
+}
+
+static void mirror_push_head(vec2_t pos)
+{
+	if (mirror.length == mirror.capacity)
+	{
+		return;
+	}
+
+	mirror.first					= (mirror.first + mirror.capacity - 1) % mirror.capacity;
+	mirror.segments[mirror.first] = pos;
+	mirror.length++;
+}
+
+static void mirror_push_tail(vec2_t pos)
+{
+	if (mirror.length == mirror.capacity)
+	{
+		return;
+	}
+
+	mirror.segments[(mirror.first + mirror.length) % mirror.capacity] = pos;
+	mirror.length++;
+}
+
+// replaces the windows of the previous board size or terminal size,
+// none when the board and its score row don't fit the terminal
+static void create_windows(void)
+{
+	uint16_t offset_y, offset_x;
+	uint16_t height = mirror.board_size;
+	uint16_t width	= mirror.board_size * 2;
+
+	if (win_board)
+	{
+		compositor_remove(win_board);
+		compositor_remove(win_score);
+		delwin(win_board);
+		delwin(win_score);
+		win_board = win_score = NULL;
+	}
+
+	if (height + 1 > LINES || width > COLS)
+	{
+		return;
+	}
+
+	set_offset_yx(height + 1, width, &offset_y, &offset_x);
+	win_board = newwin(height, width, offset_y + 1, offset_x);
+	win_score = newwin(1, width, offset_y, offset_x);
+	compositor_add(win_board, 1);
+	compositor_add(win_score, 1);
+}
+
+static void render_message(const char *message)
+{
+	uint16_t offset_y, offset_x;
+	set_offset_yx(1, strlen(message), &offset_y, &offset_x);
+
+	erase();
+	mvprintw(offset_y, offset_x, "%s", message);
+	compositor_damage(stdscr);
+}
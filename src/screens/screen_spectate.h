@@ -0,0 +1,13 @@
+#ifndef SCREEN_SPECTATE_H
+#define SCREEN_SPECTATE_H
+
+#include "../defs.h"
+
+void screen_spectate_init(void);
+void screen_spectate_dispose(void);
+bool screen_spectate_is_completed(void);
+void screen_spectate_update(void);
+void screen_spectate_render(void);
+void screen_spectate_window_resized(void);
+
+#endif
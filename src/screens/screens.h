@@ -1,3 +1,4 @@
 #include "screen_game.h"
 #include "screen_init.h"
 #include "screen_result.h"
+#include "screen_spectate.h"
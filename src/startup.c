@@ -0,0 +1,50 @@
+#define _POSIX_C_SOURCE 199309L
+#include "startup.h"
+
+typedef struct startup_phase_t
+{
+	const char *name; // static string
+	uint64_t	end;  // nanoseconds since startup_begin
+} startup_phase_t;
+
+static uint64_t		   begin = 0;
+static startup_phase_t phases[STARTUP_MAX_PHASES];
+static uint8_t		   phases_length = 0;
+
+static uint64_t get_time_ns(void);
+
+void startup_begin(void)
+{
+	begin		  = get_time_ns();
+	phases_length = 0;
+}
+
+// closes the phase started by the previous mark
+void startup_mark(const char *phase)
+{
+	if (phases_length < STARTUP_MAX_PHASES)
+	{
+		phases[phases_length++] = (startup_phase_t) { .name = phase, .end = get_time_ns() - begin };
+	}
+}
+
+void startup_report(FILE *output)
+{
+	uint64_t start = 0;
+
+	fprintf(output, "startup phase            start ms  duration ms\n");
+
+	for (uint8_t i = 0; i < phases_length; i++)
+	{
+		fprintf(output, "  %-22s %8.3f  %11.3f\n", phases[i].name, start / 1e6, (phases[i].end - start) / 1e6);
+		start = phases[i].end;
+	}
+}
+
+static uint64_t get_time_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
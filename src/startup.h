@@ -0,0 +1,16 @@
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include "defs.h"
+
+// Startup tracer: CLOCK_MONOTONIC timestamps at the end of each startup
+// phase, from main() to the first frame on screen and the work deferred
+// past it. ./snake --startup-report prints them on exit.
+
+#define STARTUP_MAX_PHASES 32 // later marks are dropped
+
+void startup_begin(void);
+void startup_mark(const char *phase);
+void startup_report(FILE *output);
+
+#endif
@@ -0,0 +1,176 @@
+#define _POSIX_C_SOURCE 200809L
+#include "stats.h"
+#include "common.h"
+#include "mem.h"
+#include "terminal.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Publishes the live counters of this instance on a shared memory page.
+// Updating the page is a handful of stores per frame and never blocks:
+// readers detect a torn copy through the sequence number and retry.
+
+#define STATS_PERCENTILES_INTERVAL 16 // frames between percentile updates
+
+static stats_page_t *page = NULL;
+static char			 page_name[32];
+static stats_t		 stats;
+static float32_t	 frame_times[STATS_FRAME_WINDOW]; // ring, milliseconds
+static float32_t	 frame_times_sorted[STATS_FRAME_WINDOW];
+
+// called by the game screen with the latest simulation snapshot
+void stats_game(uint64_t sim_ticks, score_t score, uint32_t length)
+{
+	stats.sim_ticks = sim_ticks;
+	stats.score		= score.current;
+	stats.record	= score.record;
+	stats.length	= length;
+}
+
+#ifdef __linux__
+
+static void count_output(const void *data, size_t length);
+static void update_percentiles(void);
+static int	compare_float(const void *a, const void *b);
+
+bool stats_open(void)
+{
+	snprintf(page_name, sizeof(page_name), "/" STATS_SHM_PREFIX "%d", (int)getpid());
+
+	int fd = shm_open(page_name, O_CREAT | O_TRUNC | O_RDWR, 0644);
+
+	if (fd == -1)
+	{
+		return false;
+	}
+
+	if (ftruncate(fd, sizeof(stats_page_t)) == -1)
+	{
+		close(fd);
+		shm_unlink(page_name);
+		return false;
+	}
+
+	page = mmap(NULL, sizeof(stats_page_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (page == MAP_FAILED)
+	{
+		page = NULL;
+		shm_unlink(page_name);
+		return false;
+	}
+
+	stats.pid		 = getpid();
+	stats.started_at = time(NULL);
+	page->stats		 = stats;
+	__atomic_store_n(&page->magic, STATS_MAGIC, __ATOMIC_RELEASE);
+
+	terminal_add_sink(&count_output);
+
+	return true;
+}
+
+void stats_close(void)
+{
+	if (!page)
+	{
+		return;
+	}
+
+	terminal_remove_sink(&count_output);
+	munmap(page, sizeof(stats_page_t));
+	shm_unlink(page_name);
+	page = NULL;
+}
+
+void stats_frame(uint8_t screen, float32_t frame_time)
+{
+	struct timespec now;
+	int				input_pending = 0;
+
+	if (!page)
+	{
+		return;
+	}
+
+	frame_times[stats.frames % STATS_FRAME_WINDOW] = frame_time * 1000;
+	stats.frames++;
+	stats.screen = screen;
+
+	if (stats.frames % STATS_PERCENTILES_INTERVAL == 0)
+	{
+		update_percentiles();
+	}
+
+	mem_counters_t allocated = mem_total();
+	stats.allocations		 = allocated.allocations;
+	stats.allocated_bytes	 = allocated.bytes;
+	stats.frame_allocations	 = mem_frame_total().allocations;
+
+	if (ioctl(STDIN_FILENO, FIONREAD, &input_pending) == 0)
+	{
+		stats.input_pending = input_pending;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	stats.updated_at = (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+
+	uint32_t sequence = page->sequence;
+	__atomic_store_n(&page->sequence, sequence + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	page->stats = stats;
+	__atomic_store_n(&page->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+static void count_output(const void *data, size_t length)
+{
+	(void)data;
+	stats.bytes_written += length;
+	stats.writes++;
+}
+
+static void update_percentiles(void)
+{
+	uint32_t length = stats.frames < STATS_FRAME_WINDOW ? stats.frames : STATS_FRAME_WINDOW;
+
+	memcpy(frame_times_sorted, frame_times, length * sizeof(float32_t));
+	qsort(frame_times_sorted, length, sizeof(float32_t), &compare_float);
+
+	stats.frame_time_p50 = frame_times_sorted[length * 50 / 100];
+	stats.frame_time_p95 = frame_times_sorted[length * 95 / 100];
+	stats.frame_time_p99 = frame_times_sorted[length * 99 / 100];
+	stats.frame_time_max = frame_times_sorted[length - 1];
+}
+
+static int compare_float(const void *a, const void *b)
+{
+	float32_t fa = *(const float32_t *)a;
+	float32_t fb = *(const float32_t *)b;
+
+	return (fa > fb) - (fa < fb);
+}
+
+#else
+
+bool stats_open(void)
+{
+	return false;
+}
+
+void stats_close(void)
+{
+}
+
+void stats_frame(uint8_t screen, float32_t frame_time)
+{
+	(void)screen;
+	(void)frame_time;
+}
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include "defs.h"
+
+// Every running game publishes its live counters on a shared memory
+// page named STATS_SHM_PREFIX<pid> (/dev/shm on Linux). snake-top maps
+// all of them read-only to monitor the instances of a host.
+
+#define STATS_SHM_PREFIX "ascii-snake."
+#define STATS_MAGIC 0x32534e53 // "SNS2", bump with any layout change
+#define STATS_FRAME_WINDOW 128 // frames the percentiles are computed over
+
+typedef struct stats_t
+{
+	int32_t	  pid;
+	uint8_t	  screen;		 // main.c screen_t
+	uint64_t  started_at;	 // unix time, seconds
+	uint64_t  updated_at;	 // CLOCK_MONOTONIC, nanoseconds
+	uint64_t  frames;		 // frames rendered
+	uint64_t  sim_ticks;	 // simulation steps
+	uint64_t  bytes_written; // bytes sent to the terminal
+	uint64_t  writes;		 // write(2) calls on the terminal
+	uint64_t  allocations;	 // through mem.h, since the start
+	uint64_t  allocated_bytes;
+	uint32_t  frame_allocations; // during the last frame
+	uint32_t  score;
+	uint32_t  record;
+	uint32_t  length;		 // snake segments
+	uint32_t  input_pending; // bytes waiting on the terminal input
+	float32_t frame_time_p50; // milliseconds
+	float32_t frame_time_p95;
+	float32_t frame_time_p99;
+	float32_t frame_time_max;
+} stats_t;
+
+// Seqlock: the game is the only writer, it makes 'sequence' odd while
+// it updates 'stats'. Readers retry until they copy 'stats' with the
+// same even sequence before and after.
+typedef struct stats_page_t
+{
+	uint32_t magic;
+	uint32_t sequence;
+	stats_t	 stats;
+} stats_page_t;
+
+bool stats_open(void);
+void stats_close(void);
+void stats_frame(uint8_t screen, float32_t frame_time);
+void stats_game(uint64_t sim_ticks, score_t score, uint32_t length);
+
+#endif
@@ -0,0 +1,74 @@
+#define _GNU_SOURCE
+#include "terminal.h"
+#include "common.h"
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static terminal_sink_t sinks[TERMINAL_MAX_SINKS];
+static uint8_t		   sinks_length = 0;
+
+void terminal_add_sink(terminal_sink_t sink)
+{
+	ASSERT(sinks_length < TERMINAL_MAX_SINKS);
+	sinks[sinks_length++] = sink;
+}
+
+void terminal_remove_sink(terminal_sink_t sink)
+{
+	for (uint8_t i = 0; i < sinks_length; i++)
+	{
+		if (sinks[i] == sink)
+		{
+			sinks[i] = sinks[--sinks_length];
+			return;
+		}
+	}
+}
+
+#ifdef __linux__
+bool terminal_size(uint16_t *rows, uint16_t *cols)
+{
+	struct winsize size;
+
+	if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) < 0 || !size.ws_row || !size.ws_col)
+	{
+		return false;
+	}
+
+	*rows = size.ws_row;
+	*cols = size.ws_col;
+
+	return true;
+}
+
+// curses flushes every frame with write(2) on the terminal fd.
+// Defining write() here interposes the libc symbol for the curses
+// shared library, so the sinks see the exact bytes the terminal gets
+// without a second pass over the output.
+ssize_t write(int fd, const void *buf, size_t count)
+{
+	ssize_t result = syscall(SYS_write, fd, buf, count);
+
+	if (fd == STDOUT_FILENO && result > 0)
+	{
+		for (uint8_t i = 0; i < sinks_length; i++)
+		{
+			sinks[i](buf, result);
+		}
+	}
+
+	return result;
+}
+#else
+bool terminal_size(uint16_t *rows, uint16_t *cols)
+{
+	(void)rows;
+	(void)cols;
+
+	return false;
+}
+#endif
@@ -0,0 +1,18 @@
+#ifndef TERMINAL_H
+#define TERMINAL_H
+
+#include "defs.h"
+
+#define TERMINAL_MAX_SINKS 4
+
+// Receives every chunk of bytes written to the terminal, right after
+// it was sent. Sinks run on the writing thread and must be cheap.
+typedef void (*terminal_sink_t)(const void *data, size_t length);
+
+void terminal_add_sink(terminal_sink_t sink);
+void terminal_remove_sink(terminal_sink_t sink);
+
+// size of the terminal on stdout, false when it isn't a terminal
+bool terminal_size(uint16_t *rows, uint16_t *cols);
+
+#endif
@@ -0,0 +1,857 @@
+#define _DEFAULT_SOURCE
+#include "../common.h"
+#include "stats_reader.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <libgen.h>
+#include <limits.h>
+#include <poll.h>
+#include <pty.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// End to end input latency and output volume benchmark.
+// Runs the game under a pseudo terminal, plays arrow keys at fixed
+// times and follows the snake on a small VT emulator fed with the
+// game output, measuring what a player sees:
+//   - turn: key sent -> the tongue points to the new direction
+//   - move: key sent -> the head is drawn one cell further that way
+// Output volume per frame comes from the game stats page (stats.h).
+// Thresholds turn it into a regression gate: the exit status is 1 when
+// any of them is exceeded.
+//
+//   snake-bench [--exe ./snake] [--keys 40] [--interval-ms 733] [--seed 1]
+//               [--max-move-p99-ms N] [--max-bytes-per-frame N]
+
+#define BENCH_ROWS 50
+#define BENCH_COLS 100
+#define BENCH_MAX_KEYS 1024
+#define BENCH_STARTUP_MS 5000
+
+typedef struct cell_t
+{
+	char ch;
+	bool acs; // DEC special graphics
+} cell_t;
+
+// the subset of xterm curses actually uses
+typedef struct terminal_t
+{
+	cell_t	cells[BENCH_ROWS][BENCH_COLS];
+	int16_t row, col;
+	int16_t saved_row, saved_col;
+	int16_t top, bottom; // scrolling region
+	bool	acs;
+	bool	wrap_pending;
+	char	last; // for REP
+	bool	last_acs;
+	uint8_t state;
+	int32_t params[16];
+	uint8_t params_length;
+} terminal_t;
+
+typedef enum parser_state_t
+{
+	PARSER_GROUND  = 0,
+	PARSER_ESCAPE  = 1,
+	PARSER_CSI	   = 2,
+	PARSER_CHARSET = 3,
+	PARSER_SKIP	   = 4
+} parser_state_t;
+
+typedef enum direction_t
+{
+	DIRECTION_NONE	= 0,
+	DIRECTION_LEFT	= 1,
+	DIRECTION_RIGHT = 2,
+	DIRECTION_UP	= 3,
+	DIRECTION_DOWN	= 4
+} direction_t;
+
+typedef struct head_t
+{
+	int16_t		row, col; // left half of the head
+	direction_t direction;
+} head_t;
+
+typedef struct bench_options_t
+{
+	const char *exe;
+	uint32_t	keys;
+	uint32_t	interval_ms;
+	const char *seed;
+	float64_t	max_move_p99_ms;	 // 0: no gate
+	float64_t	max_bytes_per_frame; // 0: no gate
+} bench_options_t;
+
+#ifdef __linux__
+
+static const char *key_sequences[] = { "", "\033OD", "\033OC", "\033OA", "\033OB" };
+static const int8_t row_step[]		 = { 0, 0, 0, -1, 1 };
+static const int8_t col_step[]		 = { 0, -2, 2, 0, 0 };
+// turn clockwise, never reversing into the body
+static const direction_t next_direction[] = { DIRECTION_UP, DIRECTION_UP, DIRECTION_DOWN, DIRECTION_RIGHT, DIRECTION_LEFT };
+
+static bench_options_t options = { .exe = "./snake", .keys = 40, .interval_ms = 733, .seed = "1" };
+static terminal_t terminal;
+static int		  master   = -1;
+static uint64_t	  pty_bytes = 0;
+static float64_t  turn_ms[BENCH_MAX_KEYS];
+static float64_t  move_ms[BENCH_MAX_KEYS];
+
+static void		 parse_options(int argc, char *argv[]);
+static pid_t	 spawn(void);
+static bool		 pump(uint64_t until);
+static void		 terminal_reset(void);
+static void		 terminal_feed(const uint8_t *data, size_t length);
+static void		 terminal_print(char ch);
+static void		 terminal_csi(char final);
+static void		 terminal_line_feed(void);
+static void		 terminal_scroll(int16_t top, int16_t bottom, int16_t lines);
+static void		 terminal_clear(int16_t row, int16_t from, int16_t to);
+static bool		 is_acs(int16_t row, int16_t col, char ch);
+static bool		 find_head(head_t *head);
+static bool		 find_text(const char *text);
+static bool		 wait_head(head_t *head, uint64_t until);
+static bool		 read_stats(pid_t pid, stats_t *stats);
+static void		 report(const char *name, float64_t *values, uint32_t length);
+static float64_t percentile(const float64_t *sorted, uint32_t length, uint32_t p);
+static int		 compare_double(const void *a, const void *b);
+static uint64_t	 get_time(void);
+
+int main(int argc, char *argv[])
+{
+	stats_t	 begin, end;
+	head_t	 head;
+	uint32_t turns = 0, moves = 0, missed = 0, restarts = 0;
+
+	parse_options(argc, argv);
+	terminal_reset();
+
+	pid_t pid = spawn();
+
+	// splash screen, then start a game
+	uint64_t splash = get_time() + 1000000000ULL;
+
+	while (pump(splash))
+	{
+	}
+
+	ASSERT(write(master, "\r", 1) == 1);
+
+	if (!wait_head(&head, get_time() + BENCH_STARTUP_MS * 1000000ULL))
+	{
+		fprintf(stderr, "the game screen never showed up\n");
+		kill(pid, SIGKILL);
+		return 1;
+	}
+
+	bool	 stats_available = read_stats(pid, &begin);
+	uint64_t pty_begin		 = pty_bytes;
+	uint64_t next_key		 = get_time();
+
+	for (uint32_t i = 0; i < options.keys && i < BENCH_MAX_KEYS; i++)
+	{
+		while (pump(next_key))
+		{
+		}
+
+		next_key += options.interval_ms * 1000000ULL;
+
+		if (!find_head(&head))
+		{
+			// lost: restart the game and skip this key
+			if (find_text("play again"))
+			{
+				ASSERT(write(master, "\r", 1) == 1);
+				restarts++;
+			}
+
+			missed++;
+			continue;
+		}
+
+		direction_t direction = next_direction[head.direction];
+		const char *key		  = key_sequences[direction];
+		ASSERT(write(master, key, strlen(key)) == (ssize_t)strlen(key));
+
+		uint64_t sent	  = get_time();
+		bool	 turned	  = false;
+		bool	 moved	  = false;
+		head_t	 previous = head;
+
+		while (pump(next_key))
+		{
+			if (!find_head(&head))
+			{
+				continue;
+			}
+
+			// the snake may still move the old way before the key lands
+			if (head.direction != direction)
+			{
+				previous = head;
+				continue;
+			}
+
+			if (!turned)
+			{
+				turn_ms[turns++] = (get_time() - sent) / 1e6;
+				turned			 = true;
+			}
+
+			if (head.row == previous.row + row_step[direction] && head.col == previous.col + col_step[direction])
+			{
+				move_ms[moves++] = (get_time() - sent) / 1e6;
+				moved			 = true;
+				break;
+			}
+		}
+
+		if (!moved)
+		{
+			missed++;
+		}
+	}
+
+	uint32_t frames = 0;
+
+	if (stats_available && read_stats(pid, &end))
+	{
+		frames = end.frames - begin.frames;
+	}
+
+	ASSERT(write(master, "\033", 1) == 1);
+	uint64_t quit = get_time() + 500000000ULL;
+
+	while (pump(quit))
+	{
+	}
+
+	kill(pid, SIGTERM);
+	waitpid(pid, NULL, 0);
+
+	printf("keys %u, turned %u, moved %u, missed %u, restarts %u\n", options.keys, turns, moves, missed, restarts);
+	report("turn latency ms", turn_ms, turns);
+	report("move latency ms", move_ms, moves);
+
+	float64_t bytes_per_frame = 0;
+
+	if (frames)
+	{
+		bytes_per_frame = (float64_t)(end.bytes_written - begin.bytes_written) / frames;
+		printf("output: %u frames, %.1f bytes/frame, %.2f writes/frame, %.1f pty bytes/frame\n", frames, bytes_per_frame,
+			   (float64_t)(end.writes - begin.writes) / frames, (float64_t)(pty_bytes - pty_begin) / frames);
+	}
+	else
+	{
+		printf("output: no stats page, %llu pty bytes\n", (unsigned long long)(pty_bytes - pty_begin));
+	}
+
+	qsort(move_ms, moves, sizeof(float64_t), &compare_double);
+	float64_t move_p99 = moves ? percentile(move_ms, moves, 99) : 0;
+	bool	  failed   = false;
+
+	if (options.max_move_p99_ms && (!moves || move_p99 > options.max_move_p99_ms))
+	{
+		printf("FAIL: move latency p99 %.1fms over %.1fms\n", move_p99, options.max_move_p99_ms);
+		failed = true;
+	}
+
+	if (options.max_bytes_per_frame && (!frames || bytes_per_frame > options.max_bytes_per_frame))
+	{
+		printf("FAIL: %.1f bytes/frame over %.1f\n", bytes_per_frame, options.max_bytes_per_frame);
+		failed = true;
+	}
+
+	return failed;
+}
+
+static void parse_options(int argc, char *argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--exe") && i + 1 < argc)
+		{
+			options.exe = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--keys") && i + 1 < argc)
+		{
+			options.keys = strtoul(argv[++i], NULL, 10);
+		}
+		else if (!strcmp(argv[i], "--interval-ms") && i + 1 < argc)
+		{
+			options.interval_ms = strtoul(argv[++i], NULL, 10);
+		}
+		else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+		{
+			options.seed = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--max-move-p99-ms") && i + 1 < argc)
+		{
+			options.max_move_p99_ms = strtod(argv[++i], NULL);
+		}
+		else if (!strcmp(argv[i], "--max-bytes-per-frame") && i + 1 < argc)
+		{
+			options.max_bytes_per_frame = strtod(argv[++i], NULL);
+		}
+		else
+		{
+			fprintf(stderr,
+					"usage: %s [options]\n"
+					"  --exe PATH                 game binary (default ./snake)\n"
+					"  --keys N                   arrow keys to play (default 40)\n"
+					"  --interval-ms N            time between keys (default 733)\n"
+					"  --seed N                   game random seed (default 1)\n"
+					"  --max-move-p99-ms N        fail above this move latency p99\n"
+					"  --max-bytes-per-frame N    fail above this output volume\n",
+					argv[0]);
+			exit(2);
+		}
+	}
+}
+
+// runs the game on a pty from its own directory, where its assets are
+static pid_t spawn(void)
+{
+	struct winsize size = { .ws_row = BENCH_ROWS, .ws_col = BENCH_COLS };
+	char		   exe_dir[PATH_MAX], exe_path[PATH_MAX];
+
+	ASSERT(realpath(options.exe, exe_path));
+	strcpy(exe_dir, exe_path);
+
+	pid_t pid = forkpty(&master, NULL, NULL, &size);
+	ASSERT(pid != -1);
+
+	if (!pid)
+	{
+		setenv("TERM", "xterm", 1);
+		ASSERT(!chdir(dirname(exe_dir)));
+		execl(exe_path, exe_path, "--seed", options.seed, (char *)NULL);
+		_exit(127);
+	}
+
+	return pid;
+}
+
+// feeds the terminal with the game output until 'until' (monotonic ns),
+// false once the time is over
+static bool pump(uint64_t until)
+{
+	uint8_t		  buffer[65536];
+	struct pollfd fd  = { .fd = master, .events = POLLIN };
+	uint64_t	  now = get_time();
+
+	if (now >= until)
+	{
+		return false;
+	}
+
+	if (poll(&fd, 1, (until - now + 999999) / 1000000) > 0)
+	{
+		ssize_t length = read(master, buffer, sizeof(buffer));
+
+		if (length > 0)
+		{
+			pty_bytes += length;
+			terminal_feed(buffer, length);
+		}
+		else
+		{
+			usleep((until - get_time()) / 1000); // child is gone
+			return false;
+		}
+	}
+
+	return get_time() < until;
+}
+
+static void terminal_reset(void)
+{
+	memset(&terminal, 0, sizeof(terminal_t));
+
+	for (int16_t row = 0; row < BENCH_ROWS; row++)
+	{
+		terminal_clear(row, 0, BENCH_COLS);
+	}
+
+	terminal.bottom = BENCH_ROWS - 1;
+}
+
+static void terminal_feed(const uint8_t *data, size_t length)
+{
+	for (size_t i = 0; i < length; i++)
+	{
+		uint8_t ch = data[i];
+
+		switch ((parser_state_t)terminal.state)
+		{
+		case PARSER_GROUND:
+			if (ch == 0x1b)
+			{
+				terminal.state = PARSER_ESCAPE;
+			}
+			else if (ch == '\r')
+			{
+				terminal.col		  = 0;
+				terminal.wrap_pending = false;
+			}
+			else if (ch == '\n')
+			{
+				terminal_line_feed();
+			}
+			else if (ch == '\b' && terminal.col > 0)
+			{
+				terminal.col--;
+			}
+			else if (ch == '\t')
+			{
+				terminal.col = (terminal.col / 8 + 1) * 8 < BENCH_COLS ? (terminal.col / 8 + 1) * 8 : BENCH_COLS - 1;
+			}
+			else if (ch >= 0x20 && ch < 0x7f)
+			{
+				terminal_print(ch);
+			}
+			else if (ch >= 0xc0)
+			{
+				terminal_print('?'); // first byte of a UTF-8 sequence
+			}
+			break;
+		case PARSER_ESCAPE:
+			terminal.state = PARSER_GROUND;
+
+			if (ch == '[')
+			{
+				terminal.state		   = PARSER_CSI;
+				terminal.params_length = 0;
+				memset(terminal.params, 0, sizeof(terminal.params));
+			}
+			else if (ch == '(')
+			{
+				terminal.state = PARSER_CHARSET;
+			}
+			else if (ch == ')' || ch == '*' || ch == '+' || ch == '#')
+			{
+				terminal.state = PARSER_SKIP;
+			}
+			else if (ch == '7')
+			{
+				terminal.saved_row = terminal.row;
+				terminal.saved_col = terminal.col;
+			}
+			else if (ch == '8')
+			{
+				terminal.row = terminal.saved_row;
+				terminal.col = terminal.saved_col;
+			}
+			else if (ch == 'M')
+			{
+				if (terminal.row == terminal.top)
+				{
+					terminal_scroll(terminal.top, terminal.bottom, -1);
+				}
+				else if (terminal.row > 0)
+				{
+					terminal.row--;
+				}
+			}
+			else if (ch == 'D')
+			{
+				terminal_line_feed();
+			}
+			break;
+		case PARSER_CSI:
+			if (ch >= '0' && ch <= '9')
+			{
+				if (!terminal.params_length)
+				{
+					terminal.params_length = 1;
+				}
+
+				int32_t *param = &terminal.params[terminal.params_length - 1];
+				*param		   = *param * 10 + (ch - '0');
+			}
+			else if (ch == ';')
+			{
+				if (!terminal.params_length)
+				{
+					terminal.params_length = 1;
+				}
+
+				if (terminal.params_length < 16)
+				{
+					terminal.params_length++;
+				}
+			}
+			else if (ch >= 0x40 && ch <= 0x7e)
+			{
+				terminal_csi(ch);
+				terminal.state = PARSER_GROUND;
+			}
+			break;
+		case PARSER_CHARSET:
+			terminal.acs   = ch == '0';
+			terminal.state = PARSER_GROUND;
+			break;
+		case PARSER_SKIP:
+			terminal.state = PARSER_GROUND;
+			break;
+		}
+	}
+}
+
+static void terminal_print(char ch)
+{
+	if (terminal.wrap_pending)
+	{
+		terminal.col		  = 0;
+		terminal.wrap_pending = false;
+		terminal_line_feed();
+	}
+
+	terminal.cells[terminal.row][terminal.col] = (cell_t){ .ch = ch, .acs = terminal.acs };
+	terminal.last							   = ch;
+	terminal.last_acs						   = terminal.acs;
+
+	if (terminal.col == BENCH_COLS - 1)
+	{
+		terminal.wrap_pending = true;
+	}
+	else
+	{
+		terminal.col++;
+	}
+}
+
+static void terminal_csi(char final)
+{
+	int32_t first = terminal.params_length ? terminal.params[0] : 0;
+	int32_t count = first ? first : 1;
+
+	terminal.wrap_pending = false;
+
+	switch (final)
+	{
+	case 'H':
+	case 'f':
+		terminal.row = (first ? first : 1) - 1;
+		terminal.col = (terminal.params_length > 1 && terminal.params[1] ? terminal.params[1] : 1) - 1;
+		break;
+	case 'A':
+		terminal.row -= count;
+		break;
+	case 'B':
+		terminal.row += count;
+		break;
+	case 'C':
+		terminal.col += count;
+		break;
+	case 'D':
+		terminal.col -= count;
+		break;
+	case 'G':
+	case '`':
+		terminal.col = count - 1;
+		break;
+	case 'd':
+		terminal.row = count - 1;
+		break;
+	case 'J':
+		if (first == 0)
+		{
+			terminal_clear(terminal.row, terminal.col, BENCH_COLS);
+
+			for (int16_t row = terminal.row + 1; row < BENCH_ROWS; row++)
+			{
+				terminal_clear(row, 0, BENCH_COLS);
+			}
+		}
+		else
+		{
+			for (int16_t row = 0; row < BENCH_ROWS; row++)
+			{
+				terminal_clear(row, 0, BENCH_COLS);
+			}
+		}
+		break;
+	case 'K':
+		if (first == 0)
+		{
+			terminal_clear(terminal.row, terminal.col, BENCH_COLS);
+		}
+		else if (first == 1)
+		{
+			terminal_clear(terminal.row, 0, terminal.col + 1);
+		}
+		else
+		{
+			terminal_clear(terminal.row, 0, BENCH_COLS);
+		}
+		break;
+	case 'X':
+		terminal_clear(terminal.row, terminal.col, terminal.col + count);
+		break;
+	case 'b':
+		for (int32_t i = 0; i < count; i++)
+		{
+			bool acs	 = terminal.acs;
+			terminal.acs = terminal.last_acs;
+			terminal_print(terminal.last);
+			terminal.acs = acs;
+		}
+		break;
+	case 'P':
+	case '@':
+	{
+		cell_t *line = terminal.cells[terminal.row];
+		int16_t col	 = terminal.col;
+		count		 = count < BENCH_COLS - col ? count : BENCH_COLS - col;
+
+		if (final == 'P')
+		{
+			memmove(&line[col], &line[col + count], (BENCH_COLS - col - count) * sizeof(cell_t));
+			terminal_clear(terminal.row, BENCH_COLS - count, BENCH_COLS);
+		}
+		else
+		{
+			memmove(&line[col + count], &line[col], (BENCH_COLS - col - count) * sizeof(cell_t));
+			terminal_clear(terminal.row, col, col + count);
+		}
+		break;
+	}
+	case 'L':
+		terminal_scroll(terminal.row, terminal.bottom, -count);
+		break;
+	case 'M':
+		terminal_scroll(terminal.row, terminal.bottom, count);
+		break;
+	case 'r':
+		terminal.top	= (first ? first : 1) - 1;
+		terminal.bottom = (terminal.params_length > 1 && terminal.params[1] ? terminal.params[1] : BENCH_ROWS) - 1;
+		terminal.row	= 0;
+		terminal.col	= 0;
+		break;
+	default:
+		break; // attributes and modes don't change the cells
+	}
+
+	terminal.row = terminal.row < 0 ? 0 : terminal.row >= BENCH_ROWS ? BENCH_ROWS - 1 : terminal.row;
+	terminal.col = terminal.col < 0 ? 0 : terminal.col >= BENCH_COLS ? BENCH_COLS - 1 : terminal.col;
+}
+
+static void terminal_line_feed(void)
+{
+	if (terminal.row == terminal.bottom)
+	{
+		terminal_scroll(terminal.top, terminal.bottom, 1);
+	}
+	else if (terminal.row < BENCH_ROWS - 1)
+	{
+		terminal.row++;
+	}
+}
+
+// positive 'lines' scroll up, negative scroll down
+static void terminal_scroll(int16_t top, int16_t bottom, int16_t lines)
+{
+	int16_t height = bottom - top + 1;
+	int16_t count  = lines > 0 ? lines : -lines;
+
+	if (height <= 0)
+	{
+		return;
+	}
+
+	count = count < height ? count : height;
+
+	if (lines > 0)
+	{
+		memmove(terminal.cells[top], terminal.cells[top + count], (height - count) * sizeof(terminal.cells[0]));
+
+		for (int16_t row = bottom - count + 1; row <= bottom; row++)
+		{
+			terminal_clear(row, 0, BENCH_COLS);
+		}
+	}
+	else
+	{
+		memmove(terminal.cells[top + count], terminal.cells[top], (height - count) * sizeof(terminal.cells[0]));
+
+		for (int16_t row = top; row < top + count; row++)
+		{
+			terminal_clear(row, 0, BENCH_COLS);
+		}
+	}
+}
+
+static void terminal_clear(int16_t row, int16_t from, int16_t to)
+{
+	to = to < BENCH_COLS ? to : BENCH_COLS;
+
+	for (int16_t col = from; col < to; col++)
+	{
+		terminal.cells[row][col] = (cell_t){ .ch = ' ', .acs = false };
+	}
+}
+
+static bool is_acs(int16_t row, int16_t col, char ch)
+{
+	return row >= 0 && row < BENCH_ROWS && col >= 0 && col < BENCH_COLS &&
+		   terminal.cells[row][col].acs && terminal.cells[row][col].ch == ch;
+}
+
+// The head is the body block ('a', checkerboard) the tongue (a corner
+// glyph) sticks out of, see render_snake in screen_game.c.
+static bool find_head(head_t *head)
+{
+	for (int16_t row = 0; row < BENCH_ROWS; row++)
+	{
+		for (int16_t col = 0; col < BENCH_COLS; col++)
+		{
+			if (!terminal.cells[row][col].acs)
+			{
+				continue;
+			}
+
+			head_t found = { .direction = DIRECTION_NONE };
+
+			switch (terminal.cells[row][col].ch)
+			{
+			case 'l':
+				found = (head_t){ row + 1, col - 1, DIRECTION_UP };
+				break;
+			case 'j':
+				found = (head_t){ row - 1, col, DIRECTION_DOWN };
+				break;
+			case 'm':
+				found = (head_t){ row, col + 1, DIRECTION_LEFT };
+				break;
+			case 'k':
+				found = (head_t){ row, col - 2, DIRECTION_RIGHT };
+				break;
+			default:
+				continue;
+			}
+
+			if (is_acs(found.row, found.col, 'a') && is_acs(found.row, found.col + 1, 'a'))
+			{
+				*head = found;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+static bool find_text(const char *text)
+{
+	size_t length = strlen(text);
+
+	for (int16_t row = 0; row < BENCH_ROWS; row++)
+	{
+		for (int16_t col = 0; col + (int16_t)length <= BENCH_COLS; col++)
+		{
+			size_t i = 0;
+
+			while (i < length && !terminal.cells[row][col + i].acs && terminal.cells[row][col + i].ch == text[i])
+			{
+				i++;
+			}
+
+			if (i == length)
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+static bool wait_head(head_t *head, uint64_t until)
+{
+	while (!find_head(head))
+	{
+		if (!pump(until))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool read_stats(pid_t pid, stats_t *stats)
+{
+	char name[64];
+	snprintf(name, sizeof(name), "/" STATS_SHM_PREFIX "%d", (int)pid);
+
+	int fd = shm_open(name, O_RDONLY, 0);
+
+	if (fd == -1)
+	{
+		return false;
+	}
+
+	const stats_page_t *page = mmap(NULL, sizeof(stats_page_t), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (page == MAP_FAILED)
+	{
+		return false;
+	}
+
+	bool read = page->magic == STATS_MAGIC && stats_page_read(page, stats);
+	munmap((void *)page, sizeof(stats_page_t));
+
+	return read;
+}
+
+static void report(const char *name, float64_t *values, uint32_t length)
+{
+	if (!length)
+	{
+		printf("%s: no samples\n", name);
+		return;
+	}
+
+	qsort(values, length, sizeof(float64_t), &compare_double);
+	printf("%s: p50 %.1f, p90 %.1f, p99 %.1f, max %.1f\n", name,
+		   percentile(values, length, 50), percentile(values, length, 90),
+		   percentile(values, length, 99), values[length - 1]);
+}
+
+static float64_t percentile(const float64_t *sorted, uint32_t length, uint32_t p)
+{
+	return sorted[(length - 1) * p / 100];
+}
+
+static int compare_double(const void *a, const void *b)
+{
+	float64_t da = *(const float64_t *)a;
+	float64_t db = *(const float64_t *)b;
+
+	return (da > db) - (da < db);
+}
+
+static uint64_t get_time(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+#else
+
+int main(void)
+{
+	fprintf(stderr, "snake-bench is only available on Linux\n");
+	return 1;
+}
+
+#endif
@@ -0,0 +1,275 @@
+#define _DEFAULT_SOURCE
+#include "stats_reader.h"
+
+#ifdef __linux__
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Monitors every game running on this host through their stats pages.
+// Pages are mapped read-only and read with the seqlock protocol, so
+// watching a game never slows it down.
+//
+//   snake-top          live view, refreshed every second, q quits
+//   snake-top --once   print one sample and exit
+
+#define TOP_MAX_INSTANCES 64
+#define TOP_SHM_PATH "/dev/shm"
+#define TOP_STALE_NS 2000000000ULL // no frame for this long: stalled
+
+#ifdef __linux__
+
+typedef struct instance_t
+{
+	const stats_page_t *page;
+	stats_t				current;
+	stats_t				previous;
+	bool				seen;	  // still listed on the last scan
+	bool				sampled; // 'previous' holds a valid sample
+} instance_t;
+
+static const char *screen_names[] = { "-", "init", "game", "result", "spectate" };
+
+static instance_t instances[TOP_MAX_INSTANCES];
+static uint8_t	  instances_length = 0;
+
+static void		  scan(void);
+static void		  attach(const char *name, int32_t pid);
+static void		  sample(void);
+static void		  format_row(const instance_t *instance, uint64_t now, float64_t interval, char *row, size_t size);
+static uint64_t	  get_time(void);
+
+int main(int argc, char *argv[])
+{
+	bool	 once	  = argc > 1 && !strcmp(argv[1], "--once");
+	char	 row[256] = { '\0' };
+	uint64_t last	  = get_time();
+
+	if (argc > 1 && !once)
+	{
+		fprintf(stderr, "usage: %s [--once]\n", argv[0]);
+		return 1;
+	}
+
+	scan();
+	sample();
+
+	if (once)
+	{
+		// two samples a short time apart for the rates
+		usleep(250000);
+		sample();
+		uint64_t now = get_time();
+
+		printf("%-8s %-8s %8s %8s %6s %6s %7s %7s %7s %9s %7s %9s %6s %s\n",
+			   "PID", "SCREEN", "FRAMES", "TICKS/S", "FPS", "SCORE", "LENGTH", "P50ms", "P99ms", "KiB/s", "WR/FRM", "ALLOC/FRM", "INPUT", "STATE");
+
+		for (uint8_t i = 0; i < instances_length; i++)
+		{
+			format_row(&instances[i], now, (now - last) / 1e9, row, sizeof(row));
+			printf("%s\n", row);
+		}
+
+		return 0;
+	}
+
+	initscr();
+	cbreak();
+	noecho();
+	curs_set(0);
+	timeout(1000);
+
+	while (getch() != 'q')
+	{
+		scan();
+		sample();
+		uint64_t now = get_time();
+
+		erase();
+		attron(A_REVERSE);
+		mvprintw(0, 0, "%-8s %-8s %8s %8s %6s %6s %7s %7s %7s %9s %7s %9s %6s %-8s",
+				 "PID", "SCREEN", "FRAMES", "TICKS/S", "FPS", "SCORE", "LENGTH", "P50ms", "P99ms", "KiB/s", "WR/FRM", "ALLOC/FRM", "INPUT", "STATE");
+		attroff(A_REVERSE);
+
+		for (uint8_t i = 0; i < instances_length; i++)
+		{
+			format_row(&instances[i], now, (now - last) / 1e9, row, sizeof(row));
+			mvprintw(i + 1, 0, "%s", row);
+		}
+
+		mvprintw(instances_length + 2, 0, "%d instance(s), q to quit", instances_length);
+		refresh();
+		last = now;
+	}
+
+	endwin();
+
+	return 0;
+}
+
+// Maps the pages of new games and drops the pages of finished ones.
+// Pages left behind by games that crashed are removed.
+static void scan(void)
+{
+	DIR			  *dir = opendir(TOP_SHM_PATH);
+	struct dirent *entry;
+
+	for (uint8_t i = 0; i < instances_length; i++)
+	{
+		instances[i].seen = false;
+	}
+
+	if (dir)
+	{
+		while ((entry = readdir(dir)))
+		{
+			size_t prefix_length = strlen(STATS_SHM_PREFIX);
+
+			if (strncmp(entry->d_name, STATS_SHM_PREFIX, prefix_length))
+			{
+				continue;
+			}
+
+			int32_t pid = atoi(entry->d_name + prefix_length);
+
+			if (kill(pid, 0) == -1 && errno == ESRCH)
+			{
+				char name[NAME_MAX + 2];
+				snprintf(name, sizeof(name), "/%s", entry->d_name);
+				shm_unlink(name);
+				continue;
+			}
+
+			attach(entry->d_name, pid);
+		}
+
+		closedir(dir);
+	}
+
+	for (uint8_t i = 0; i < instances_length;)
+	{
+		if (instances[i].seen)
+		{
+			i++;
+			continue;
+		}
+
+		munmap((void *)instances[i].page, sizeof(stats_page_t));
+		instances[i] = instances[--instances_length];
+	}
+}
+
+static void attach(const char *name, int32_t pid)
+{
+	char path[NAME_MAX + 2];
+
+	for (uint8_t i = 0; i < instances_length; i++)
+	{
+		if (instances[i].current.pid == pid)
+		{
+			instances[i].seen = true;
+			return;
+		}
+	}
+
+	if (instances_length == TOP_MAX_INSTANCES)
+	{
+		return;
+	}
+
+	snprintf(path, sizeof(path), "/%s", name);
+	int fd = shm_open(path, O_RDONLY, 0);
+
+	if (fd == -1)
+	{
+		return;
+	}
+
+	const stats_page_t *page = mmap(NULL, sizeof(stats_page_t), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (page == MAP_FAILED)
+	{
+		return;
+	}
+
+	if (__atomic_load_n(&page->magic, __ATOMIC_ACQUIRE) != STATS_MAGIC)
+	{
+		// not initialized yet or another layout version
+		munmap((void *)page, sizeof(stats_page_t));
+		return;
+	}
+
+	instance_t *instance = &instances[instances_length++];
+	memset(instance, 0, sizeof(instance_t));
+	instance->page		  = page;
+	instance->seen		  = true;
+	instance->current.pid = pid;
+}
+
+static void sample(void)
+{
+	for (uint8_t i = 0; i < instances_length; i++)
+	{
+		instance_t *instance = &instances[i];
+		stats_t		stats;
+
+		if (stats_page_read(instance->page, &stats))
+		{
+			instance->previous = instance->current;
+			instance->sampled  = instance->current.updated_at != 0;
+			instance->current  = stats;
+		}
+	}
+}
+
+static void format_row(const instance_t *instance, uint64_t now, float64_t interval, char *row, size_t size)
+{
+	const stats_t *current	= &instance->current;
+	const stats_t *previous = &instance->previous;
+	float64_t	   fps = 0, ticks = 0, kib = 0, writes_per_frame = 0, allocations_per_frame = 0;
+	uint64_t	   frames = 0;
+	const char	  *screen = current->screen < sizeof(screen_names) / sizeof(screen_names[0]) ? screen_names[current->screen] : "?";
+
+	if (instance->sampled && interval > 0)
+	{
+		frames = current->frames - previous->frames;
+		fps	   = frames / interval;
+		ticks  = (current->sim_ticks - previous->sim_ticks) / interval;
+		kib	   = (current->bytes_written - previous->bytes_written) / 1024.0 / interval;
+
+		if (frames)
+		{
+			writes_per_frame	  = (float64_t)(current->writes - previous->writes) / frames;
+			allocations_per_frame = (float64_t)(current->allocations - previous->allocations) / frames;
+		}
+	}
+
+	snprintf(row, size, "%-8d %-8s %8llu %8.0f %6.1f %6u %7u %7.1f %7.1f %9.1f %7.2f %9.2f %6u %s",
+			 current->pid, screen, (unsigned long long)current->frames, ticks, fps, current->score, current->length,
+			 current->frame_time_p50, current->frame_time_p99, kib, writes_per_frame, allocations_per_frame, current->input_pending,
+			 now - current->updated_at > TOP_STALE_NS ? "STALLED" : "ok");
+}
+
+static uint64_t get_time(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+#else
+
+int main(void)
+{
+	fprintf(stderr, "snake-top is only available on Linux\n");
+	return 1;
+}
+
+#endif
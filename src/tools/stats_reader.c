@@ -0,0 +1,26 @@
+#include "stats_reader.h"
+
+// Reader side of the stats page seqlock, see stats.h. False when the
+// game kept writing during every retry.
+bool stats_page_read(const stats_page_t *page, stats_t *stats)
+{
+	for (uint32_t retries = 0; retries < STATS_READ_RETRIES; retries++)
+	{
+		uint32_t begin = __atomic_load_n(&page->sequence, __ATOMIC_ACQUIRE);
+
+		if (begin & 1)
+		{
+			continue; // being written
+		}
+
+		memcpy(stats, (const void *)&page->stats, sizeof(stats_t));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+		if (__atomic_load_n(&page->sequence, __ATOMIC_RELAXED) == begin)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,10 @@
+#ifndef STATS_READER_H
+#define STATS_READER_H
+
+#include "../stats.h"
+
+#define STATS_READ_RETRIES 100
+
+bool stats_page_read(const stats_page_t *page, stats_t *stats);
+
+#endif
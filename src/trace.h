@@ -0,0 +1,46 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Static tracepoints (USDT, provider "snake") on the game loop and the
+// data structure hot paths. When <sys/sdt.h> is available (systemtap
+// sdt headers) each tracepoint is a single nop in the code plus a note
+// in the ELF, so they cost nothing until a tracer attaches to them:
+//
+//   bpftrace -e 'usdt:./snake:snake:move { printf("%d,%d\n", arg0, arg1); }' -p PID
+//   perf buildid-cache --add ./snake && perf record -e sdt_snake:frame_start -p PID
+//
+// Without the header, or built with 'make TRACE=off', they compile to
+// nothing. Arguments must be integers or pointers and are never
+// evaluated when tracing is compiled out.
+//
+// Tracepoints:
+//   frame_start(frame)                  frame_end(frame)
+//   screen(from, to)                    game_update(sim_ticks)
+//   move(x, y)                          collision(x, y)
+//   fruit_spawn(slot, x, y)             fruit_eat(slot, x, y)
+//   fruit_expire(slot, x, y)           trapped(reachable_cells, length)
+//   window_refresh(win, z)              doupdate_start(windows)
+//   doupdate_end(windows)
+//   sparse_set_grow(old_size, new_size)
+//   vector_reserve(type_size, old_capacity, new_capacity)
+
+#if defined(__linux__) && !defined(TRACE_OFF) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define TRACE_ENABLED
+#endif
+#endif
+
+#ifdef TRACE_ENABLED
+#define TRACE0(name) DTRACE_PROBE(snake, name)
+#define TRACE1(name, a) DTRACE_PROBE1(snake, name, a)
+#define TRACE2(name, a, b) DTRACE_PROBE2(snake, name, a, b)
+#define TRACE3(name, a, b, c) DTRACE_PROBE3(snake, name, a, b, c)
+#else
+#define TRACE0(name) ((void)0)
+#define TRACE1(name, a) ((void)sizeof(a))
+#define TRACE2(name, a, b) ((void)sizeof(a), (void)sizeof(b))
+#define TRACE3(name, a, b, c) ((void)sizeof(a), (void)sizeof(b), (void)sizeof(c))
+#endif
+
+#endif
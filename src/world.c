@@ -0,0 +1,308 @@
+#define _POSIX_C_SOURCE 199309L
+#include "world.h"
+#include "common.h"
+#include "mem.h"
+
+#define WORLD_SPAWN_TRIES 16 // random cells tried per fruit spawn
+// body cell 'i' from the head
+#define WORLD_BODY_AT(world, i) ((world)->body[((world)->head - (i)) & ((world)->capacity - 1)])
+
+// x, y delta per snake_direction_t
+static const int8_t steps[][2] = { { 0, 0 }, { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+
+static snake_direction_t decide(world_t *world);
+static uint32_t			 space(world_t *world, world_point_t from);
+static void				 advance(world_t *world, world_point_t next);
+static void				 grow_body(world_t *world);
+static void				 die(world_t *world);
+static void				 spawn_fruit(world_t *world, uint8_t slot);
+
+world_t world_new(uint32_t seed)
+{
+	world_t world = {
+		.tiles	   = tile_map_new(64),
+		.capacity  = 64,
+		.length	   = 1,
+		.longest   = 1,
+		.direction = SNAKE_DIRECTION_LEFT,
+		.rng	   = random_seed(seed, 0),
+	};
+
+	world.body = mem_calloc(world.capacity, sizeof(world_point_t));
+	ASSERT(world.body);
+	tile_map_set(&world.tiles, 0, 0, WORLD_CELL_BODY);
+
+	for (uint8_t slot = 0; slot < FRUIT_POOL_LENGTH; slot++)
+	{
+		spawn_fruit(&world, slot);
+	}
+
+	world.peak_bytes = world_bytes(&world);
+
+	return world;
+}
+
+void world_dispose(world_t *world)
+{
+	tile_map_dispose(&world->tiles);
+	mem_free(world->body);
+	memset(world, 0, sizeof(world_t));
+}
+
+void world_tick(world_t *world)
+{
+	world->tick++;
+	world->tiles.now = world->tick;
+
+	for (uint8_t slot = 0; slot < FRUIT_POOL_LENGTH; slot++)
+	{
+		world_point_t fruit = world->fruits[slot];
+
+		if (fruit.x == WORLD_NO_FRUIT)
+		{
+			spawn_fruit(world, slot); // still waiting for a free cell
+		}
+		else if (world->tick >= world->fruit_expiry[slot])
+		{
+			tile_map_set(&world->tiles, fruit.x, fruit.y, WORLD_CELL_FREE);
+			spawn_fruit(world, slot);
+		}
+	}
+
+	snake_direction_t direction = decide(world);
+	world_point_t	  head		= WORLD_BODY_AT(world, 0);
+
+	if (direction == SNAKE_DIRECTION_IDLE)
+	{
+		die(world);
+	}
+	else
+	{
+		world->direction = direction;
+		advance(world, (world_point_t) { head.x + steps[direction][0], head.y + steps[direction][1] });
+	}
+
+	if (world->tick % WORLD_SWEEP_TICKS == 0)
+	{
+		tile_map_sweep(&world->tiles, WORLD_COLD_TICKS);
+	}
+
+	uint64_t bytes = world_bytes(world);
+
+	world->peak_bytes = bytes > world->peak_bytes ? bytes : world->peak_bytes;
+}
+
+// resident: cells, hash table and body
+uint64_t world_bytes(const world_t *world)
+{
+	return world->tiles.bytes + (uint64_t)world->tiles.capacity * sizeof(tile_map_tile_t) +
+		   (uint64_t)world->capacity * sizeof(world_point_t);
+}
+
+void world_session(uint32_t ticks, uint32_t seed)
+{
+	struct timespec start, end;
+	world_t			world = world_new(seed ? seed : (uint32_t)time(NULL));
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (uint32_t i = 0; i < ticks; i++)
+	{
+		world_tick(&world);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	float64_t seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	int64_t	  width	  = (int64_t)world.max.x - world.min.x + 1;
+	int64_t	  height  = (int64_t)world.max.y - world.min.y + 1;
+
+	fprintf(stderr, "world: %u ticks in %.3fs, %.0f ticks/s\n", ticks, seconds, ticks / seconds);
+	fprintf(stderr, "  length %u (longest %u), %llu fruits eaten, %llu deaths\n", world.length, world.longest,
+			(unsigned long long)world.fruits_eaten, (unsigned long long)world.deaths);
+	fprintf(stderr, "  explored %lldx%lld cells, a dense board of them would take %.1f KiB\n", (long long)width,
+			(long long)height, width * height / 1024.0);
+	fprintf(stderr, "  %u tiles (%u compressed, %llu evicted), %.1f KiB resident, %.1f KiB peak\n", world.tiles.length,
+			world.tiles.compressed, (unsigned long long)world.tiles.evicted, world_bytes(&world) / 1024.0,
+			world.peak_bytes / 1024.0);
+
+	world_dispose(&world);
+}
+
+// Toward the closest fruit, among the moves that lead to WORLD_LOOKAHEAD
+// free cells, if any. Ties go to a random move. IDLE when shut in.
+static snake_direction_t decide(world_t *world)
+{
+	world_point_t	  head	= WORLD_BODY_AT(world, 0);
+	snake_direction_t best	= SNAKE_DIRECTION_IDLE;
+	uint64_t		  least = UINT64_MAX;
+
+	for (uint8_t d = SNAKE_DIRECTION_LEFT; d <= SNAKE_DIRECTION_BOTTOM; d++)
+	{
+		world_point_t cell = { head.x + steps[d][0], head.y + steps[d][1] };
+
+		if (tile_map_get(&world->tiles, cell.x, cell.y) == WORLD_CELL_BODY)
+		{
+			continue;
+		}
+
+		uint32_t distance = UINT32_MAX;
+
+		for (uint8_t slot = 0; slot < FRUIT_POOL_LENGTH; slot++)
+		{
+			world_point_t fruit = world->fruits[slot];
+
+			if (fruit.x != WORLD_NO_FRUIT)
+			{
+				uint32_t to = labs((long)fruit.x - cell.x) + labs((long)fruit.y - cell.y);
+
+				distance = to < distance ? to : distance;
+			}
+		}
+
+		// room first, then distance, then chance
+		uint64_t key = (uint64_t)(WORLD_LOOKAHEAD - space(world, cell)) << 48 | (uint64_t)distance << 16 |
+					   (random_next(&world->rng) & 0xffff);
+
+		if (key < least)
+		{
+			least = key;
+			best  = d;
+		}
+	}
+
+	return best;
+}
+
+// cells without body reached from 'from' breadth first, WORLD_LOOKAHEAD at most
+static uint32_t space(world_t *world, world_point_t from)
+{
+	world_point_t queue[WORLD_LOOKAHEAD];
+	uint32_t	  length = 0;
+
+	queue[length++] = from;
+
+	for (uint32_t i = 0; i < length && length < WORLD_LOOKAHEAD; i++)
+	{
+		for (uint8_t d = SNAKE_DIRECTION_LEFT; d <= SNAKE_DIRECTION_BOTTOM && length < WORLD_LOOKAHEAD; d++)
+		{
+			world_point_t next = { queue[i].x + steps[d][0], queue[i].y + steps[d][1] };
+			bool		  seen = tile_map_get(&world->tiles, next.x, next.y) == WORLD_CELL_BODY;
+
+			for (uint32_t j = 0; j < length && !seen; j++)
+			{
+				seen = queue[j].x == next.x && queue[j].y == next.y;
+			}
+
+			if (!seen)
+			{
+				queue[length++] = next;
+			}
+		}
+	}
+
+	return length;
+}
+
+// onto 'next' (no body on it), growing on a fruit
+static void advance(world_t *world, world_point_t next)
+{
+	bool ate = tile_map_get(&world->tiles, next.x, next.y) == WORLD_CELL_FRUIT;
+
+	if (ate)
+	{
+		for (uint8_t slot = 0; slot < FRUIT_POOL_LENGTH; slot++)
+		{
+			if (world->fruits[slot].x == next.x && world->fruits[slot].y == next.y)
+			{
+				world->fruits[slot].x = WORLD_NO_FRUIT; // respawns next tick, away from the head
+			}
+		}
+
+		world->fruits_eaten++;
+
+		if (world->length == world->capacity)
+		{
+			grow_body(world);
+		}
+	}
+	else
+	{
+		world_point_t tail = WORLD_BODY_AT(world, world->length - 1);
+
+		tile_map_set(&world->tiles, tail.x, tail.y, WORLD_CELL_FREE);
+		world->length--;
+	}
+
+	world->head				 = (world->head + 1) & (world->capacity - 1);
+	world->body[world->head] = next;
+	world->length++;
+	tile_map_set(&world->tiles, next.x, next.y, WORLD_CELL_BODY);
+
+	world->longest = world->length > world->longest ? world->length : world->longest;
+	world->min.x   = next.x < world->min.x ? next.x : world->min.x;
+	world->min.y   = next.y < world->min.y ? next.y : world->min.y;
+	world->max.x   = next.x > world->max.x ? next.x : world->max.x;
+	world->max.y   = next.y > world->max.y ? next.y : world->max.y;
+}
+
+// twice the capacity, the ring unrolled from the tail
+static void grow_body(world_t *world)
+{
+	world_point_t *body = mem_alloc(sizeof(world_point_t) * world->capacity * 2);
+
+	ASSERT(body);
+
+	for (uint32_t i = 0; i < world->length; i++)
+	{
+		body[i] = WORLD_BODY_AT(world, world->length - 1 - i);
+	}
+
+	mem_free(world->body);
+	world->capacity *= 2;
+
+	world->body = body;
+	world->head = world->length - 1;
+}
+
+// the body leaves the board, a new snake starts on the head's cell
+static void die(world_t *world)
+{
+	world_point_t head = WORLD_BODY_AT(world, 0);
+
+	for (uint32_t i = 1; i < world->length; i++)
+	{
+		world_point_t cell = WORLD_BODY_AT(world, i);
+
+		tile_map_set(&world->tiles, cell.x, cell.y, WORLD_CELL_FREE);
+	}
+
+	world->deaths++;
+	world->head	   = 0;
+	world->length  = 1;
+	world->body[0] = head;
+}
+
+// on a random free cell around the head, or none until there's one
+static void spawn_fruit(world_t *world, uint8_t slot)
+{
+	world_point_t head = WORLD_BODY_AT(world, 0);
+
+	world->fruits[slot].x = WORLD_NO_FRUIT;
+
+	for (uint8_t i = 0; i < WORLD_SPAWN_TRIES; i++)
+	{
+		world_point_t cell = {
+			head.x + (int32_t)(random_next(&world->rng) % (2 * WORLD_SPAWN_RADIUS + 1)) - WORLD_SPAWN_RADIUS,
+			head.y + (int32_t)(random_next(&world->rng) % (2 * WORLD_SPAWN_RADIUS + 1)) - WORLD_SPAWN_RADIUS,
+		};
+
+		if (tile_map_get(&world->tiles, cell.x, cell.y) == WORLD_CELL_FREE)
+		{
+			tile_map_set(&world->tiles, cell.x, cell.y, WORLD_CELL_FRUIT);
+			world->fruits[slot]		  = cell;
+			world->fruit_expiry[slot] = world->tick + WORLD_FRUIT_TICKS;
+			return;
+		}
+	}
+}
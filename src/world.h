@@ -0,0 +1,65 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include "data_structures/tile_map.h"
+#include "defs.h"
+#include "rules.h"
+
+// Open world: an endurance session of one AI snake on a board without
+// walls nor edges (./snake --world --train TICKS, headless). The board is
+// a tile map (data_structures/tile_map.h): memory follows the cells the
+// snake and the fruits used lately, not the area explored so far.
+// The snake moves once per tick toward the closest fruit. Fruits spawn
+// around its head and expire after WORLD_FRUIT_TICKS, so it keeps
+// wandering off. A snake shut in by its own body dies and starts over
+// where its head was.
+
+#define WORLD_DEFAULT_TICKS 100000 // --world without --train
+#define WORLD_SPAWN_RADIUS 32	   // fruits spawn this close to the head, on each axis
+#define WORLD_FRUIT_TICKS 600	   // fruit lifetime
+#define WORLD_LOOKAHEAD 32		   // free cells a move must lead to, when there's a choice
+#define WORLD_SWEEP_TICKS 1024	   // between tile map sweeps
+#define WORLD_COLD_TICKS 4096	   // tiles not written for this long are evicted or compressed
+#define WORLD_NO_FRUIT INT32_MIN   // x of a fruit slot waiting for a free cell
+
+typedef enum world_cell_t
+{
+	WORLD_CELL_FREE = 0,
+	WORLD_CELL_BODY,
+	WORLD_CELL_FRUIT
+} world_cell_t;
+
+typedef struct world_point_t
+{
+	int32_t x;
+	int32_t y;
+} world_point_t;
+
+typedef struct world_t
+{
+	tile_map_t		  tiles; // world_cell_t per cell
+	world_point_t	 *body;	 // ring of 'capacity' cells, grows with the snake
+	uint32_t		  capacity;
+	uint32_t		  head; // ring position of the head
+	uint32_t		  length;
+	snake_direction_t direction;
+	world_point_t	  fruits[FRUIT_POOL_LENGTH];
+	uint64_t		  fruit_expiry[FRUIT_POOL_LENGTH]; // tick
+	uint32_t		  rng;							   // xorshift32
+	uint64_t		  tick;
+	// totals
+	uint64_t	  fruits_eaten;
+	uint64_t	  deaths;
+	uint32_t	  longest;
+	uint64_t	  peak_bytes; // tiles, hash table and body
+	world_point_t min;		  // explored area, corners
+	world_point_t max;
+} world_t;
+
+world_t	 world_new(uint32_t seed);
+void	 world_dispose(world_t *world);
+void	 world_tick(world_t *world);
+uint64_t world_bytes(const world_t *world);
+void	 world_session(uint32_t ticks, uint32_t seed);
+
+#endif